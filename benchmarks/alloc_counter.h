@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2026 Daniel Markstedt <daniel@mindani.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+// Counts every heap allocation made by the process, including those inside
+// Qt, by interposing glibc's allocator entry points; operator new ends up
+// here as well.  Include from exactly one source file of a benchmark.
+
+#ifndef KAFP_ALLOC_COUNTER_H
+#define KAFP_ALLOC_COUNTER_H
+
+#include <atomic>
+#include <cstddef>
+
+static std::atomic<long> allocations { 0 };
+
+static long allocationCount()
+{
+    return allocations.load(std::memory_order_relaxed);
+}
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t n, size_t size);
+void *__libc_realloc(void *p, size_t size);
+
+void *malloc(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(n, size);
+}
+
+void *realloc(void *p, size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(p, size);
+}
+}
+
+#endif // KAFP_ALLOC_COUNTER_H
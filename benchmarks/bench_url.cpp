@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2026 Daniel Markstedt <daniel@mindani.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+// Micro-benchmark for the per-operation URL parsing and path name
+// encoding cost.  Every worker operation starts with parseAfpUrl(), and
+// every listed entry goes through AfpPathCodec::decodeName().  Reports
+// time and heap allocations per call.
+//
+// Usage: bench_url [iterations]
+
+#include "alloc_counter.h"
+#include "kafp_url.h"
+
+#include <QElapsedTimer>
+#include <QUrl>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+template<typename Fn>
+static void run(const char *label, long iterations, Fn &&fn)
+{
+    // Warm up caches and the allocator before timing
+    for (long i = 0; i < iterations / 10; ++i)
+        fn();
+
+    // Count allocations in a separate pass so the timed loop stays clean
+    const long before = allocationCount();
+    const long counted = std::min(iterations, 1000L);
+    for (long i = 0; i < counted; ++i)
+        fn();
+    const double allocs = static_cast<double>(allocationCount() - before)
+        / static_cast<double>(counted);
+
+    QElapsedTimer timer;
+    timer.start();
+    for (long i = 0; i < iterations; ++i)
+        fn();
+    const double ns = static_cast<double>(timer.nsecsElapsed()) / static_cast<double>(iterations);
+    std::printf("%-28s %10.1f ns/op %6.2f allocs/op\n", label, ns, allocs);
+}
+
+int main(int argc, char **argv)
+{
+    const long iterations = argc > 1 ? std::atol(argv[1]) : 200000;
+    if (iterations <= 0) {
+        std::fprintf(stderr, "Usage: %s [iterations]\n", argv[0]);
+        return 1;
+    }
+
+    AfpPathCodec codec;
+    const QUrl asciiUrl(QStringLiteral("afp://server/Projects/src/kio-afp/src/kafp_worker.cpp"));
+    const QUrl unicodeUrl(QStringLiteral("afp://server/Projects/Résumés/Français/Übersicht.pdf"));
+    const QByteArray asciiName("kafp_worker.cpp");
+    const QByteArray nfdName = QStringLiteral("Übersicht.pdf")
+                                   .normalized(QString::NormalizationForm_D)
+                                   .toUtf8();
+
+    // Keep the results observable so the loops aren't optimised away
+    volatile qsizetype sink = 0;
+
+    run("parseAfpUrl ascii", iterations, [&] {
+        sink = sink + parseAfpUrl(asciiUrl, codec).path.size();
+    });
+    run("parseAfpUrl non-ascii", iterations, [&] {
+        sink = sink + parseAfpUrl(unicodeUrl, codec).path.size();
+    });
+    const ParsedUrl parsed = parseAfpUrl(asciiUrl, codec);
+    run("leafName", iterations, [&] {
+        sink = sink + parsed.leafName().size();
+    });
+    run("decodeName ascii", iterations, [&] {
+        sink = sink + codec.decodeName(asciiName.constData()).size();
+    });
+    run("decodeName non-ascii", iterations, [&] {
+        sink = sink + codec.decodeName(nfdName.constData()).size();
+    });
+    run("encodePath non-ascii", iterations, [&] {
+        sink = sink + codec.encodePath(u"Résumés/Français").size();
+    });
+
+    return 0;
+}
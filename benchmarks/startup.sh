@@ -0,0 +1,60 @@
+#!/bin/bash
+# Startup-time benchmark for the kio-afp worker executable
+# Copyright (c) 2026 Daniel Markstedt <daniel@mindani.net>
+#
+#  This program is free software; you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License as published by
+#  the Free Software Foundation; either version 2 of the License, or
+#  (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+# Runs "kio-afp --startup-profile" repeatedly and reports wall-clock
+# startup time (process exec, dynamic linking and worker initialisation).
+# Set STARTUP_BUDGET_MS to fail when the median exceeds that budget.
+
+set -uo pipefail
+
+EXE="${1:?Usage: $0 path/to/kio-afp [runs]}"
+RUNS="${2:-${STARTUP_RUNS:-50}}"
+BUDGET_MS="${STARTUP_BUDGET_MS:-}"
+
+if [[ ! -x "$EXE" ]]; then
+    echo "startup.sh: $EXE is not executable" >&2
+    exit 1
+fi
+
+# Warm the page cache so the first run isn't an outlier
+"$EXE" --startup-profile 2>/dev/null
+
+times=()
+for ((i = 0; i < RUNS; i++)); do
+    start=$(date +%s%N)
+    profile=$("$EXE" --startup-profile 2>&1 >/dev/null)
+    end=$(date +%s%N)
+    times+=($(((end - start) / 1000)))
+done
+
+mapfile -t sorted < <(printf '%s\n' "${times[@]}" | sort -n)
+min_us=${sorted[0]}
+median_us=${sorted[$((RUNS / 2))]}
+p90_us=${sorted[$((RUNS * 9 / 10))]}
+max_us=${sorted[$((RUNS - 1))]}
+
+fmt() { printf '%d.%03d' $(($1 / 1000)) $(($1 % 1000)); }
+
+echo "kio-afp startup over $RUNS runs:"
+echo "  min    $(fmt "$min_us") ms"
+echo "  median $(fmt "$median_us") ms"
+echo "  p90    $(fmt "$p90_us") ms"
+echo "  max    $(fmt "$max_us") ms"
+echo "  last in-process profile: ${profile#kio-afp: startup }"
+
+if [[ -n "$BUDGET_MS" && $median_us -gt $((BUDGET_MS * 1000)) ]]; then
+    echo "FAIL: median startup exceeds budget of ${BUDGET_MS} ms"
+    exit 1
+fi
+exit 0
@@ -0,0 +1,15 @@
+/*
+ * Copyright (C) 2025-2026 Daniel Markstedt <daniel@mindani.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+extern "C" int kdemain(int argc, char **argv);
+
+int main(int argc, char **argv)
+{
+    return kdemain(argc, argv);
+}
@@ -0,0 +1,453 @@
+/*
+ * Copyright (C) 2026 Daniel Markstedt <daniel@mindani.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include "kafp_stats.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtAlgorithms>
+#include <algorithm>
+#include <cerrno>
+#include <iterator>
+#include <signal.h>
+
+// Minimum time between two writes of the stats file
+static constexpr qint64 STATS_WRITE_INTERVAL_MS = 10 * 1000;
+
+// Transfer progress is sampled every TRANSFER_SAMPLE_INTERVAL_MS, and each
+// sample weighs RATE_SMOOTHING in the smoothed rate
+static constexpr qint64 TRANSFER_SAMPLE_INTERVAL_MS = 250;
+static constexpr double RATE_SMOOTHING = 0.3;
+
+// Smallest file whose rate counts towards TransferTotals' last and minimum
+static constexpr qint64 TRANSFER_RATE_MIN_BYTES = 1024 * 1024;
+
+// libafpsl calls made by the current thread, for OperationTimer
+static thread_local quint64 t_threadCalls = 0;
+
+// Wire counters the current thread's calls are charged to, see setSession()
+static thread_local WireCounters *t_serverWire = nullptr;
+static thread_local WireCounters *t_volumeWire = nullptr;
+
+static const char *const CALL_NAMES[] = {
+    "connect", "disconnect", "getvols", "attach", "getvolid", "stat", "statfs",
+    "readdir", "open", "read", "write", "close", "creat", "truncate", "chmod",
+    "mkdir", "unlink", "rmdir", "rename",
+};
+static_assert(std::size(CALL_NAMES) == static_cast<size_t>(AfpCall::Count));
+
+static const char *const OPERATION_NAMES[] = {
+    "stat", "listDir", "get", "put", "mkdir", "del", "rename", "chmod",
+    "fileSystemFreeSpace", "special",
+};
+static_assert(std::size(OPERATION_NAMES) == static_cast<size_t>(KioOp::Count));
+
+const char *afpCallName(AfpCall call)
+{
+    return CALL_NAMES[static_cast<size_t>(call)];
+}
+
+const char *kioOpName(KioOp op)
+{
+    return OPERATION_NAMES[static_cast<size_t>(op)];
+}
+
+// ---------------------------------------------------------------------------
+// LatencyHistogram
+// ---------------------------------------------------------------------------
+
+void LatencyHistogram::record(qint64 nsecs, bool failed)
+{
+    const quint64 us = static_cast<quint64>(std::max<qint64>(nsecs, 0)) / 1000;
+    const int bucket = std::min(BUCKETS - 1, us < 2 ? 0 : 63 - static_cast<int>(qCountLeadingZeroBits(us)));
+
+    m_buckets[static_cast<size_t>(bucket)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_totalUs.fetch_add(us, std::memory_order_relaxed);
+    if (failed)
+        m_errors.fetch_add(1, std::memory_order_relaxed);
+
+    quint64 max = m_maxUs.load(std::memory_order_relaxed);
+    while (us > max && !m_maxUs.compare_exchange_weak(max, us, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::reset()
+{
+    for (auto &bucket : m_buckets)
+        bucket.store(0, std::memory_order_relaxed);
+    m_count.store(0, std::memory_order_relaxed);
+    m_errors.store(0, std::memory_order_relaxed);
+    m_totalUs.store(0, std::memory_order_relaxed);
+    m_maxUs.store(0, std::memory_order_relaxed);
+}
+
+quint64 LatencyHistogram::percentileUs(double q) const
+{
+    const quint64 total = count();
+    if (total == 0)
+        return 0;
+
+    const auto rank = static_cast<quint64>(q * static_cast<double>(total - 1)) + 1;
+    quint64 seen = 0;
+    for (int i = 0; i < BUCKETS; ++i) {
+        seen += m_buckets[static_cast<size_t>(i)].load(std::memory_order_relaxed);
+        if (seen >= rank)
+            return std::min(quint64(2) << i, m_maxUs.load(std::memory_order_relaxed));
+    }
+    return m_maxUs.load(std::memory_order_relaxed);
+}
+
+QJsonObject LatencyHistogram::toJson() const
+{
+    // Buckets as [upper bound in µs, count] pairs, empty ones left out
+    QJsonArray buckets;
+    for (int i = 0; i < BUCKETS; ++i) {
+        if (const quint64 n = m_buckets[static_cast<size_t>(i)].load(std::memory_order_relaxed))
+            buckets.append(QJsonArray { static_cast<qint64>(quint64(2) << i), static_cast<qint64>(n) });
+    }
+
+    const quint64 total = count();
+    const quint64 totalUs = m_totalUs.load(std::memory_order_relaxed);
+    return QJsonObject {
+        { QStringLiteral("count"), static_cast<qint64>(total) },
+        { QStringLiteral("errors"), static_cast<qint64>(m_errors.load(std::memory_order_relaxed)) },
+        { QStringLiteral("total_us"), static_cast<qint64>(totalUs) },
+        { QStringLiteral("mean_us"), total ? static_cast<qint64>(totalUs / total) : 0 },
+        { QStringLiteral("p50_us"), static_cast<qint64>(percentileUs(0.50)) },
+        { QStringLiteral("p90_us"), static_cast<qint64>(percentileUs(0.90)) },
+        { QStringLiteral("p99_us"), static_cast<qint64>(percentileUs(0.99)) },
+        { QStringLiteral("max_us"), static_cast<qint64>(m_maxUs.load(std::memory_order_relaxed)) },
+        { QStringLiteral("buckets"), buckets },
+    };
+}
+
+// ---------------------------------------------------------------------------
+// WireCounters
+// ---------------------------------------------------------------------------
+
+void WireCounters::reset()
+{
+    for (auto &n : requests)
+        n.store(0, std::memory_order_relaxed);
+    bytesRead.store(0, std::memory_order_relaxed);
+    bytesWritten.store(0, std::memory_order_relaxed);
+    retries.store(0, std::memory_order_relaxed);
+    reconnects.store(0, std::memory_order_relaxed);
+    breakerTrips.store(0, std::memory_order_relaxed);
+    breakerRejects.store(0, std::memory_order_relaxed);
+}
+
+QJsonObject WireCounters::toJson() const
+{
+    QJsonObject byType;
+    qint64 total = 0;
+    for (size_t i = 0; i < requests.size(); ++i) {
+        if (const quint64 n = requests[i].load(std::memory_order_relaxed)) {
+            byType.insert(QLatin1String(CALL_NAMES[i]), static_cast<qint64>(n));
+            total += static_cast<qint64>(n);
+        }
+    }
+    return QJsonObject {
+        { QStringLiteral("requests"), total },
+        { QStringLiteral("requests_by_type"), byType },
+        { QStringLiteral("bytes_read"), static_cast<qint64>(bytesRead.load(std::memory_order_relaxed)) },
+        { QStringLiteral("bytes_written"), static_cast<qint64>(bytesWritten.load(std::memory_order_relaxed)) },
+        { QStringLiteral("retries"), static_cast<qint64>(retries.load(std::memory_order_relaxed)) },
+        { QStringLiteral("reconnects"), static_cast<qint64>(reconnects.load(std::memory_order_relaxed)) },
+        { QStringLiteral("breaker_trips"), static_cast<qint64>(breakerTrips.load(std::memory_order_relaxed)) },
+        { QStringLiteral("breaker_rejects"), static_cast<qint64>(breakerRejects.load(std::memory_order_relaxed)) },
+    };
+}
+
+// ---------------------------------------------------------------------------
+// libafpsl calls
+// ---------------------------------------------------------------------------
+
+std::mutex &afpslMutex()
+{
+    static std::mutex mutex;
+    return mutex;
+}
+
+// ---------------------------------------------------------------------------
+// AfpStats
+// ---------------------------------------------------------------------------
+
+AfpStats::AfpStats()
+{
+    m_uptime.start();
+    const QByteArray env = qgetenv("KIO_AFP_STATS");
+    m_writeFile = !env.isEmpty() && env != "0";
+}
+
+AfpStats &AfpStats::instance()
+{
+    static AfpStats stats;
+    return stats;
+}
+
+void AfpStats::recordCall(AfpCall call, qint64 nsecs, bool failed, quint64 bytes)
+{
+    m_calls[static_cast<size_t>(call)].record(nsecs, failed);
+    m_callCount.fetch_add(1, std::memory_order_relaxed);
+    ++t_threadCalls;
+
+    for (WireCounters *wire : { t_serverWire, t_volumeWire }) {
+        if (!wire)
+            continue;
+        wire->requests[static_cast<size_t>(call)].fetch_add(1, std::memory_order_relaxed);
+        if (call == AfpCall::Read)
+            wire->bytesRead.fetch_add(bytes, std::memory_order_relaxed);
+        else if (call == AfpCall::Write)
+            wire->bytesWritten.fetch_add(bytes, std::memory_order_relaxed);
+    }
+}
+
+quint64 AfpStats::threadCallCount()
+{
+    return t_threadCalls;
+}
+
+void AfpStats::attributeCall()
+{
+    ++t_threadCalls;
+}
+
+void AfpStats::recordOperation(KioOp op, qint64 nsecs, quint64 calls)
+{
+    const auto i = static_cast<size_t>(op);
+    m_operations[i].record(nsecs, false);
+    m_operationCalls[i] += calls;
+    m_maxOperationCalls[i] = std::max(m_maxOperationCalls[i], calls);
+    m_lastOperationCalls = calls;
+}
+
+double AfpStats::recordTransfer(KioOp op, qint64 bytes, qint64 nsecs)
+{
+    TransferTotals &t = m_transfers[op == KioOp::Put ? 1 : 0];
+    const double rate = nsecs > 0 ? static_cast<double>(bytes) * 1e9 / static_cast<double>(nsecs) : 0;
+    ++t.count;
+    t.bytes += static_cast<quint64>(bytes);
+    t.nsecs += static_cast<quint64>(nsecs);
+    if (bytes >= TRANSFER_RATE_MIN_BYTES) {
+        t.lastRate = rate;
+        t.minRate = t.minRate > 0 ? std::min(t.minRate, rate) : rate;
+    }
+    return rate;
+}
+
+WireCounters *AfpStats::wireCounters(QHash<QString, std::shared_ptr<WireCounters>> &map,
+                                     const QString &key)
+{
+    std::shared_ptr<WireCounters> &counters = map[key];
+    if (!counters)
+        counters = std::make_shared<WireCounters>();
+    return counters.get();
+}
+
+void AfpStats::setSession(const QString &server, const QString &volume)
+{
+    std::lock_guard<std::mutex> lock(m_wireMutex);
+    t_serverWire = server.isEmpty() ? nullptr : wireCounters(m_serverWire, server);
+    t_volumeWire = volume.isEmpty()
+        ? nullptr
+        : wireCounters(m_volumeWire, server + QLatin1Char('/') + volume);
+}
+
+void AfpStats::recordRetry()
+{
+    if (WireCounters *wire = t_serverWire)
+        wire->retries.fetch_add(1, std::memory_order_relaxed);
+    if (WireCounters *wire = t_volumeWire)
+        wire->retries.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AfpStats::recordReconnect()
+{
+    recordRetry();
+    if (WireCounters *wire = t_serverWire)
+        wire->reconnects.fetch_add(1, std::memory_order_relaxed);
+    if (WireCounters *wire = t_volumeWire)
+        wire->reconnects.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AfpStats::recordBreakerTrip()
+{
+    if (WireCounters *wire = t_serverWire)
+        wire->breakerTrips.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AfpStats::recordBreakerReject()
+{
+    if (WireCounters *wire = t_serverWire)
+        wire->breakerRejects.fetch_add(1, std::memory_order_relaxed);
+}
+
+QJsonObject AfpStats::wireJson() const
+{
+    std::lock_guard<std::mutex> lock(m_wireMutex);
+    QJsonObject servers;
+    for (auto it = m_serverWire.cbegin(); it != m_serverWire.cend(); ++it)
+        servers.insert(it.key(), it.value()->toJson());
+    QJsonObject volumes;
+    for (auto it = m_volumeWire.cbegin(); it != m_volumeWire.cend(); ++it)
+        volumes.insert(it.key(), it.value()->toJson());
+    return QJsonObject {
+        { QStringLiteral("servers"), servers },
+        { QStringLiteral("volumes"), volumes },
+    };
+}
+
+void AfpStats::reset()
+{
+    for (auto &h : m_calls)
+        h.reset();
+    for (auto &h : m_operations)
+        h.reset();
+    m_transfers = {};
+    m_operationCalls = {};
+    m_maxOperationCalls = {};
+    m_lastOperationCalls = 0;
+
+    std::lock_guard<std::mutex> lock(m_wireMutex);
+    for (const auto &wire : std::as_const(m_serverWire))
+        wire->reset();
+    for (const auto &wire : std::as_const(m_volumeWire))
+        wire->reset();
+}
+
+QByteArray AfpStats::toJson() const
+{
+    // Only calls and operations that happened, to keep the output readable
+    QJsonObject calls;
+    for (size_t i = 0; i < m_calls.size(); ++i) {
+        if (m_calls[i].count())
+            calls.insert(QLatin1String(CALL_NAMES[i]), m_calls[i].toJson());
+    }
+    QJsonObject operations;
+    for (size_t i = 0; i < m_operations.size(); ++i) {
+        if (!m_operations[i].count())
+            continue;
+        QJsonObject operation = m_operations[i].toJson();
+        operation.insert(QStringLiteral("afp_calls"), static_cast<qint64>(m_operationCalls[i]));
+        operation.insert(QStringLiteral("max_afp_calls"), static_cast<qint64>(m_maxOperationCalls[i]));
+        operations.insert(QLatin1String(OPERATION_NAMES[i]), operation);
+    }
+
+    QJsonObject transfers;
+    for (size_t i = 0; i < m_transfers.size(); ++i) {
+        const TransferTotals &t = m_transfers[i];
+        if (t.count == 0)
+            continue;
+        constexpr double MB = 1024.0 * 1024.0;
+        const double seconds = static_cast<double>(t.nsecs) / 1e9;
+        transfers.insert(i == 0 ? QStringLiteral("get") : QStringLiteral("put"),
+                         QJsonObject {
+                             { QStringLiteral("count"), static_cast<qint64>(t.count) },
+                             { QStringLiteral("bytes"), static_cast<qint64>(t.bytes) },
+                             { QStringLiteral("total_ms"), static_cast<qint64>(t.nsecs / 1000000) },
+                             { QStringLiteral("mb_per_s"), seconds > 0 ? static_cast<double>(t.bytes) / MB / seconds : 0.0 },
+                             { QStringLiteral("last_mb_per_s"), t.lastRate / MB },
+                             { QStringLiteral("min_mb_per_s"), t.minRate / MB },
+                         });
+    }
+
+    const QJsonObject root {
+        { QStringLiteral("pid"), static_cast<qint64>(QCoreApplication::applicationPid()) },
+        { QStringLiteral("uptime_ms"), m_uptime.elapsed() },
+        { QStringLiteral("afp_calls"), calls },
+        { QStringLiteral("operations"), operations },
+        { QStringLiteral("transfers"), transfers },
+        { QStringLiteral("wire"), wireJson() },
+    };
+    return QJsonDocument(root).toJson(QJsonDocument::Indented);
+}
+
+QString AfpStats::statsFilePath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation)
+        + QStringLiteral("/kio-afp/stats-")
+        + QString::number(QCoreApplication::applicationPid()) + QStringLiteral(".json");
+}
+
+void AfpStats::maybeWriteFile(bool force)
+{
+    if (!m_writeFile)
+        return;
+    if (!force && m_lastWrite.isValid() && m_lastWrite.elapsed() < STATS_WRITE_INTERVAL_MS)
+        return;
+    const bool firstWrite = !m_lastWrite.isValid();
+    m_lastWrite.start();
+
+    const QString path = statsFilePath();
+    const QString dir = QFileInfo(path).path();
+    if (!QDir().mkpath(dir))
+        return;
+    QFile::setPermissions(dir, QFileDevice::ReadOwner | QFileDevice::WriteOwner | QFileDevice::ExeOwner);
+
+    // Workers that crashed or were killed never removed theirs
+    if (firstWrite) {
+        const QStringList files = QDir(dir).entryList({ QStringLiteral("stats-*.json") }, QDir::Files);
+        for (const QString &name : files) {
+            bool ok = false;
+            const qint64 pid = QStringView(name).mid(6, name.size() - 11).toLongLong(&ok);
+            if (ok && pid > 0 && ::kill(static_cast<pid_t>(pid), 0) != 0 && errno == ESRCH)
+                QFile::remove(dir + QLatin1Char('/') + name);
+        }
+    }
+
+    QSaveFile out(path);
+    if (!out.open(QIODevice::WriteOnly))
+        return;
+    out.write(toJson());
+    out.commit();
+}
+
+void AfpStats::removeFile()
+{
+    if (m_writeFile && m_lastWrite.isValid())
+        QFile::remove(statsFilePath());
+}
+
+// ---------------------------------------------------------------------------
+// TransferMeter
+// ---------------------------------------------------------------------------
+
+bool TransferMeter::add(qint64 n)
+{
+    m_bytes += n;
+    const qint64 now = m_timer.nsecsElapsed();
+    const qint64 interval = now - m_sampleNsecs;
+    if (interval < TRANSFER_SAMPLE_INTERVAL_MS * 1000000)
+        return false;
+
+    const double rate = static_cast<double>(m_bytes - m_sampleBytes) * 1e9 / static_cast<double>(interval);
+    m_rate = m_rate > 0 ? RATE_SMOOTHING * rate + (1 - RATE_SMOOTHING) * m_rate : rate;
+    m_sampleBytes = m_bytes;
+    m_sampleNsecs = now;
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// OperationTimer
+// ---------------------------------------------------------------------------
+
+OperationTimer::~OperationTimer()
+{
+    AfpStats &stats = AfpStats::instance();
+    stats.recordOperation(m_op, m_timer.nsecsElapsed(), AfpStats::threadCallCount() - m_callsAtStart);
+    stats.maybeWriteFile();
+}
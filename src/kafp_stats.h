@@ -0,0 +1,301 @@
+/*
+ * Copyright (C) 2026 Daniel Markstedt <daniel@mindani.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef KAFP_STATS_H
+#define KAFP_STATS_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonObject>
+#include <QString>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include "kafp_trace.h"
+
+// libafpsl calls whose latency is recorded
+enum class AfpCall {
+    Connect,
+    Disconnect,
+    GetVols,
+    Attach,
+    GetVolId,
+    Stat,
+    Statfs,
+    Readdir,
+    Open,
+    Read,
+    Write,
+    Close,
+    Creat,
+    Truncate,
+    Chmod,
+    Mkdir,
+    Unlink,
+    Rmdir,
+    Rename,
+    Count
+};
+
+const char *afpCallName(AfpCall call);
+
+// KIO operations whose latency is recorded
+enum class KioOp {
+    Stat,
+    ListDir,
+    Get,
+    Put,
+    Mkdir,
+    Del,
+    Rename,
+    Chmod,
+    FreeSpace,
+    Special,
+    Count
+};
+
+const char *kioOpName(KioOp op);
+
+// Latency distribution in power-of-two microsecond buckets: bucket 0 holds
+// samples below 2 µs, bucket i samples in [2^i, 2^(i+1)) µs.  Recording is
+// lock-free so calls made on the connect and background threads can be
+// counted as well.
+class LatencyHistogram {
+public:
+    static constexpr int BUCKETS = 32;
+
+    void record(qint64 nsecs, bool failed);
+    void reset();
+
+    quint64 count() const { return m_count.load(std::memory_order_relaxed); }
+    // Upper bound of the bucket holding the given quantile, in µs
+    quint64 percentileUs(double q) const;
+    QJsonObject toJson() const;
+
+private:
+    std::array<std::atomic<quint64>, BUCKETS> m_buckets {};
+    std::atomic<quint64> m_count { 0 };
+    std::atomic<quint64> m_errors { 0 };
+    std::atomic<quint64> m_totalUs { 0 };
+    std::atomic<quint64> m_maxUs { 0 };
+};
+
+// Totals of the completed gets or puts of a worker
+struct TransferTotals {
+    quint64 count = 0;
+    quint64 bytes = 0;
+    quint64 nsecs = 0;
+    // Rates of files of at least TRANSFER_RATE_MIN_BYTES, in bytes/s;
+    // smaller files are dominated by per-file overhead
+    double lastRate = 0;
+    double minRate = 0;
+};
+
+// Wire-level counters of one server or volume: what this worker sent over
+// its session, for finding chatty clients
+struct WireCounters {
+    std::array<std::atomic<quint64>, static_cast<size_t>(AfpCall::Count)> requests {};
+    std::atomic<quint64> bytesRead { 0 };
+    std::atomic<quint64> bytesWritten { 0 };
+    // Calls repeated after a failure, including connect attempts
+    std::atomic<quint64> retries { 0 };
+    // Session state dropped by invalidateSessionState()
+    std::atomic<quint64> reconnects { 0 };
+    // Connect circuit breaker tripped by this worker, and connects it
+    // refused because another worker had tripped it
+    std::atomic<quint64> breakerTrips { 0 };
+    std::atomic<quint64> breakerRejects { 0 };
+
+    void reset();
+    QJsonObject toJson() const;
+};
+
+// Process-wide latency statistics of the worker.  There is one worker per
+// process, and the background threads talk to the same afpsld, so the
+// statistics are shared rather than owned by AfpWorker.
+class AfpStats {
+public:
+    static AfpStats &instance();
+
+    // bytes is the payload moved by a read or write
+    void recordCall(AfpCall call, qint64 nsecs, bool failed, quint64 bytes = 0);
+    // calls is the number of libafpsl calls made during the operation
+    void recordOperation(KioOp op, qint64 nsecs, quint64 calls);
+    // A completed get or put; returns its effective rate in bytes/s
+    double recordTransfer(KioOp op, qint64 bytes, qint64 nsecs);
+    void reset();
+
+    // Server and volume the calling thread works for; its calls are
+    // counted against them until it sets others.  Each thread has its own,
+    // so the warm-up's attaches are not charged to the operation alongside.
+    void setSession(const QString &server, const QString &volume);
+    // A call about to be repeated after a failure
+    void recordRetry();
+    // Session state dropped to reconnect; the failed call is retried
+    void recordReconnect();
+    // The connect circuit breaker was tripped, or refused a connect
+    void recordBreakerTrip();
+    void recordBreakerReject();
+    // Per-server and per-volume wire counters as a JSON object
+    QJsonObject wireJson() const;
+
+    // libafpsl calls made so far by the whole process, and by the calling
+    // thread.  Operations count their own thread's calls, so background
+    // warm-up and refresh calls are left out of them.
+    quint64 callCount() const { return m_callCount.load(std::memory_order_relaxed); }
+    static quint64 threadCallCount();
+    // A call made on a helper thread on behalf of the calling thread, e.g.
+    // the afp_sl_connect() the worker waited for
+    static void attributeCall();
+    // Calls made during the last completed operation; the round-trip
+    // budget tests assert on this
+    quint64 lastOperationCalls() const { return m_lastOperationCalls; }
+
+    // All histograms, transfer totals and wire counters as a JSON object
+    QByteArray toJson() const;
+
+    // With KIO_AFP_STATS set, write toJson() to statsFilePath() when
+    // STATS_WRITE_INTERVAL_MS have passed since the last write, or
+    // unconditionally when forced.  The first write also removes files
+    // left by workers that are no longer running.
+    void maybeWriteFile(bool force = false);
+    // Remove this process's file, on a clean exit
+    void removeFile();
+    static QString statsFilePath();
+
+private:
+    AfpStats();
+
+    std::array<LatencyHistogram, static_cast<size_t>(AfpCall::Count)> m_calls;
+    std::array<LatencyHistogram, static_cast<size_t>(KioOp::Count)> m_operations;
+    std::array<TransferTotals, 2> m_transfers; // get, put
+    // Calls per operation type, summed and the most in one operation
+    std::array<quint64, static_cast<size_t>(KioOp::Count)> m_operationCalls {};
+    std::array<quint64, static_cast<size_t>(KioOp::Count)> m_maxOperationCalls {};
+    std::atomic<quint64> m_callCount { 0 };
+    quint64 m_lastOperationCalls = 0;
+
+    // Counters are created on first use and never removed, so a thread's
+    // current ones can be updated without taking the lock
+    WireCounters *wireCounters(QHash<QString, std::shared_ptr<WireCounters>> &map, const QString &key);
+    mutable std::mutex m_wireMutex;
+    QHash<QString, std::shared_ptr<WireCounters>> m_serverWire;
+    QHash<QString, std::shared_ptr<WireCounters>> m_volumeWire; // by "server/volume"
+
+    QElapsedTimer m_uptime;
+    QElapsedTimer m_lastWrite;
+    bool m_writeFile = false;
+};
+
+// Bytes moved by one get or put and its rate, smoothed with an exponential
+// moving average over samples taken every TRANSFER_SAMPLE_INTERVAL_MS
+class TransferMeter {
+public:
+    TransferMeter() { m_timer.start(); }
+
+    // Account for n more bytes; true when a new rate sample was taken and
+    // progress is due to be reported
+    bool add(qint64 n);
+
+    qint64 bytes() const { return m_bytes; }
+    qint64 nsecsElapsed() const { return m_timer.nsecsElapsed(); }
+    // Smoothed rate in bytes/s, 0 until the first sample
+    unsigned long rate() const { return static_cast<unsigned long>(m_rate); }
+
+private:
+    QElapsedTimer m_timer;
+    qint64 m_bytes = 0;
+    qint64 m_sampleBytes = 0;
+    qint64 m_sampleNsecs = 0;
+    double m_rate = 0;
+};
+
+// libafpsl talks to afpsld over one socket per process, so the worker and
+// its background thread take turns call by call.  afp_sl_connect() is left
+// out: it can block indefinitely, and nothing else calls libafpsl while one
+// is pending (see AfpWorker::reapPendingConnect()).
+std::mutex &afpslMutex();
+
+// Times and traces one call; the caller holds afpslMutex() unless it is
+// the connect
+template<typename Fn, typename... Args>
+int afpTimedCall(AfpCall call, const unsigned int *bytes, Fn fn, Args &&...args)
+{
+    TraceSpan span("afp", afpCallName(call));
+    QElapsedTimer timer;
+    timer.start();
+    const int ret = fn(std::forward<Args>(args)...);
+    AfpStats::instance().recordCall(call, timer.nsecsElapsed(), ret != 0, bytes ? *bytes : 0);
+    span.setArg(QStringLiteral("ret"), ret);
+    if (bytes)
+        span.setArg(QStringLiteral("bytes"), static_cast<qint64>(*bytes));
+    return ret;
+}
+
+// As afpCall(), for reads and writes: *bytes holds the amount transferred
+// once fn returns
+template<typename Fn, typename... Args>
+int afpTransfer(AfpCall call, const unsigned int *bytes, Fn fn, Args &&...args)
+{
+    std::unique_lock<std::mutex> lock(afpslMutex(), std::defer_lock);
+    if (call != AfpCall::Connect)
+        lock.lock();
+    return afpTimedCall(call, bytes, fn, std::forward<Args>(args)...);
+}
+
+// Time and trace one libafpsl call, e.g. afpCall(AfpCall::Stat, afp_sl_stat, ...)
+template<typename Fn, typename... Args>
+int afpCall(AfpCall call, Fn fn, Args &&...args)
+{
+    return afpTransfer(call, nullptr, fn, std::forward<Args>(args)...);
+}
+
+// As afpCall(), then consume(ret) before any other thread can call
+// libafpsl.  For replies that point into the library's reply buffer, such
+// as the entries of afp_sl_readdir(), which the next call overwrites.
+// consume must not call libafpsl itself.
+template<typename Consume, typename Fn, typename... Args>
+int afpCallConsume(AfpCall call, Consume consume, Fn fn, Args &&...args)
+{
+    const std::lock_guard<std::mutex> lock(afpslMutex());
+    const int ret = afpTimedCall(call, nullptr, fn, std::forward<Args>(args)...);
+    consume(ret);
+    return ret;
+}
+
+// Times a KIO operation from construction to destruction, and traces it
+class OperationTimer {
+public:
+    explicit OperationTimer(KioOp op)
+        : m_op(op)
+        , m_callsAtStart(AfpStats::threadCallCount())
+        , m_span("kio", kioOpName(op))
+    {
+        m_timer.start();
+    }
+    ~OperationTimer();
+
+    OperationTimer(const OperationTimer &) = delete;
+    OperationTimer &operator=(const OperationTimer &) = delete;
+
+    // Bytes moved by a get or put, for the trace
+    void setBytes(qint64 bytes) { m_span.setArg(QStringLiteral("bytes"), bytes); }
+
+private:
+    KioOp m_op;
+    quint64 m_callsAtStart;
+    QElapsedTimer m_timer;
+    TraceSpan m_span;
+};
+
+#endif // KAFP_STATS_H
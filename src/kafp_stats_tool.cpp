@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2026 Daniel Markstedt <daniel@mindani.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+// kio-afp-stats: print the statistics of the running kio-afp workers.
+// Workers started with KIO_AFP_STATS=1 write them to
+// $XDG_RUNTIME_DIR/kio-afp/stats-<pid>.json; this tool reads those files
+// and sums the wire counters over all workers.  A KIO special job would
+// not do: KIO runs it on a worker of the calling process, never on the
+// workers of Dolphin or another client.
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStandardPaths>
+#include <QUrl>
+#include <cstdio>
+
+// Adds the numbers in from to those in into, recursing into objects
+static void sumInto(QJsonObject &into, const QJsonObject &from)
+{
+    for (auto it = from.constBegin(); it != from.constEnd(); ++it) {
+        if (it->isObject()) {
+            QJsonObject sub = into.value(it.key()).toObject();
+            sumInto(sub, it->toObject());
+            into.insert(it.key(), sub);
+        } else if (it->isDouble()) {
+            into.insert(it.key(), into.value(it.key()).toInteger() + it->toInteger());
+        }
+    }
+}
+
+// Keeps the entries of a server or volume map that belong to the filter:
+// the server, or server/volume
+static QJsonObject filtered(const QJsonObject &map, const QString &filter)
+{
+    if (filter.isEmpty())
+        return map;
+    QJsonObject out;
+    const QString prefix = filter + QLatin1Char('/');
+    for (auto it = map.constBegin(); it != map.constEnd(); ++it) {
+        if (it.key() == filter || it.key().startsWith(prefix))
+            out.insert(it.key(), it.value());
+    }
+    return out;
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("kio-afp-stats"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        QStringLiteral("Print the wire counters of the running kio-afp workers, summed over all workers, as JSON. "
+                       "Workers write them only when started with KIO_AFP_STATS=1."));
+    parser.addHelpOption();
+    const QCommandLineOption workersOption(QStringLiteral("workers"),
+                                           QStringLiteral("Print each worker's full statistics, including latency histograms and transfer totals."));
+    parser.addOption(workersOption);
+    parser.addPositionalArgument(QStringLiteral("url"), QStringLiteral("Only count afp://server[/volume]."),
+                                 QStringLiteral("[url]"));
+    parser.process(app);
+
+    const QStringList args = parser.positionalArguments();
+    if (args.size() > 1)
+        parser.showHelp(1);
+
+    QString filter;
+    if (!args.isEmpty()) {
+        const QUrl url = QUrl::fromUserInput(args.first());
+        if (url.scheme() != QLatin1String("afp") || url.host().isEmpty()) {
+            std::fprintf(stderr, "kio-afp-stats: not an afp:// URL: %s\n", qPrintable(args.first()));
+            return 1;
+        }
+        filter = url.host();
+        if (const QString volume = url.path().section(QLatin1Char('/'), 1, 1); !volume.isEmpty())
+            filter += QLatin1Char('/') + volume;
+    }
+
+    const QDir dir(QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation)
+                   + QStringLiteral("/kio-afp"));
+    const QStringList files = dir.entryList({ QStringLiteral("stats-*.json") }, QDir::Files, QDir::Name);
+    if (files.isEmpty()) {
+        std::fprintf(stderr, "kio-afp-stats: no statistics in %s; are workers running with KIO_AFP_STATS=1?\n",
+                     qPrintable(dir.path()));
+        return 1;
+    }
+
+    QJsonArray workers;
+    QJsonObject servers;
+    QJsonObject volumes;
+    for (const QString &name : files) {
+        QFile file(dir.filePath(name));
+        if (!file.open(QIODevice::ReadOnly))
+            continue; // the worker exited meanwhile
+        const QJsonObject stats = QJsonDocument::fromJson(file.readAll()).object();
+        if (stats.isEmpty())
+            continue;
+
+        const QJsonObject wire = stats.value(QStringLiteral("wire")).toObject();
+        const QJsonObject workerServers = filtered(wire.value(QStringLiteral("servers")).toObject(), filter);
+        const QJsonObject workerVolumes = filtered(wire.value(QStringLiteral("volumes")).toObject(), filter);
+        if (!filter.isEmpty() && workerServers.isEmpty() && workerVolumes.isEmpty())
+            continue;
+
+        workers.append(stats);
+        sumInto(servers, workerServers);
+        sumInto(volumes, workerVolumes);
+    }
+
+    QJsonDocument out;
+    if (parser.isSet(workersOption)) {
+        out.setArray(workers);
+    } else {
+        out.setObject(QJsonObject {
+            { QStringLiteral("workers"), workers.size() },
+            { QStringLiteral("servers"), servers },
+            { QStringLiteral("volumes"), volumes },
+        });
+    }
+    std::fputs(out.toJson().constData(), stdout);
+    return 0;
+}
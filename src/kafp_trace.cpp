@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2026 Daniel Markstedt <daniel@mindani.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include "kafp_trace.h"
+
+#include <QCoreApplication>
+#include <QJsonDocument>
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+// ---------------------------------------------------------------------------
+// AfpTrace
+// ---------------------------------------------------------------------------
+
+AfpTrace::AfpTrace()
+{
+    const QByteArray dir = qgetenv("KIO_AFP_TRACE");
+    if (dir.isEmpty())
+        return;
+
+    m_pid = QCoreApplication::applicationPid();
+    const QByteArray path = dir + "/kio-afp-trace.json";
+
+    // The first worker creates the file holding the opening '[' and its
+    // own metadata event, so that every later event, from any process, is
+    // appended as ",\n{...}".  The viewers accept a missing closing ']'.
+    const QJsonObject processName {
+        { QStringLiteral("name"), QStringLiteral("process_name") },
+        { QStringLiteral("ph"), QStringLiteral("M") },
+        { QStringLiteral("pid"), m_pid },
+        { QStringLiteral("tid"), 0 },
+        { QStringLiteral("args"),
+          QJsonObject { { QStringLiteral("name"),
+                          QStringLiteral("kio-afp %1").arg(m_pid) } } },
+    };
+    const QByteArray meta = QJsonDocument(processName).toJson(QJsonDocument::Compact);
+
+    bool created = false;
+    if (::access(path.constData(), F_OK) != 0) {
+        const QByteArray tmp = path + '.' + QByteArray::number(m_pid);
+        if (int fd = ::open(tmp.constData(), O_CREAT | O_TRUNC | O_WRONLY | O_CLOEXEC, 0600);
+            fd >= 0) {
+            const QByteArray header = '[' + meta;
+            const bool ok = ::write(fd, header.constData(), header.size()) == header.size();
+            ::close(fd);
+            // link() fails if another worker got there first
+            created = ok && ::link(tmp.constData(), path.constData()) == 0;
+            ::unlink(tmp.constData());
+        }
+    }
+
+    m_fd = ::open(path.constData(), O_WRONLY | O_APPEND | O_CLOEXEC);
+    if (m_fd >= 0 && !created) {
+        const QByteArray line = ",\n" + meta;
+        if (::write(m_fd, line.constData(), line.size()) < 0) {
+            ::close(m_fd);
+            m_fd = -1;
+        }
+    }
+}
+
+AfpTrace::~AfpTrace()
+{
+    if (m_fd >= 0)
+        ::close(m_fd);
+}
+
+AfpTrace &AfpTrace::instance()
+{
+    static AfpTrace trace;
+    return trace;
+}
+
+qint64 AfpTrace::nowUs()
+{
+    struct timespec ts {};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<qint64>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+void AfpTrace::setContext(const QString &server, const QString &volume, const QString &path)
+{
+    if (!enabled())
+        return;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_server = server;
+    m_volume = volume;
+    m_path = path;
+}
+
+void AfpTrace::complete(const char *category, const char *name, qint64 startUs, qint64 durUs,
+                        const QJsonObject &args)
+{
+    if (!enabled())
+        return;
+    writeEvent(QJsonObject {
+                   { QStringLiteral("name"), QLatin1String(name) },
+                   { QStringLiteral("cat"), QLatin1String(category) },
+                   { QStringLiteral("ph"), QStringLiteral("X") },
+                   { QStringLiteral("ts"), startUs },
+                   { QStringLiteral("dur"), durUs },
+               },
+               args);
+}
+
+void AfpTrace::instant(const char *category, const char *name, const QJsonObject &args)
+{
+    if (!enabled())
+        return;
+    writeEvent(QJsonObject {
+                   { QStringLiteral("name"), QLatin1String(name) },
+                   { QStringLiteral("cat"), QLatin1String(category) },
+                   { QStringLiteral("ph"), QStringLiteral("i") },
+                   { QStringLiteral("s"), QStringLiteral("t") },
+                   { QStringLiteral("ts"), nowUs() },
+               },
+               args);
+}
+
+void AfpTrace::writeEvent(QJsonObject event, const QJsonObject &args)
+{
+    event.insert(QStringLiteral("pid"), m_pid);
+    event.insert(QStringLiteral("tid"), static_cast<qint64>(::syscall(SYS_gettid)));
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    QJsonObject allArgs = args;
+    if (!m_server.isEmpty())
+        allArgs.insert(QStringLiteral("server"), m_server);
+    if (!m_volume.isEmpty())
+        allArgs.insert(QStringLiteral("volume"), m_volume);
+    if (!m_path.isEmpty())
+        allArgs.insert(QStringLiteral("path"), m_path);
+    if (!allArgs.isEmpty())
+        event.insert(QStringLiteral("args"), allArgs);
+
+    // One write() per event keeps events from concurrent workers whole.
+    // Tracing is best effort, a failed write just loses the event.
+    const QByteArray line = ",\n" + QJsonDocument(event).toJson(QJsonDocument::Compact);
+    [[maybe_unused]] const ssize_t written = ::write(m_fd, line.constData(), line.size());
+}
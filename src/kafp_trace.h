@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2026 Daniel Markstedt <daniel@mindani.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef KAFP_TRACE_H
+#define KAFP_TRACE_H
+
+#include <QJsonObject>
+#include <QString>
+#include <mutex>
+
+// Opt-in structured tracing.  With KIO_AFP_TRACE=<dir> in the environment,
+// every worker process appends Chrome trace events to
+// <dir>/kio-afp-trace.json, which Perfetto (ui.perfetto.dev) and
+// chrome://tracing open directly.  All workers share the file and stamp
+// events with CLOCK_MONOTONIC, so their spans line up on one timeline.
+class AfpTrace {
+public:
+    static AfpTrace &instance();
+
+    bool enabled() const { return m_fd >= 0; }
+
+    // Server, volume and path of the operation in progress, attached to
+    // every event until the next call
+    void setContext(const QString &server, const QString &volume, const QString &path);
+
+    // A span from startUs lasting durUs (a Chrome "X" event)
+    void complete(const char *category, const char *name, qint64 startUs, qint64 durUs,
+                  const QJsonObject &args);
+    // A point in time (a Chrome "i" event)
+    void instant(const char *category, const char *name, const QJsonObject &args);
+
+    static qint64 nowUs();
+
+private:
+    AfpTrace();
+    ~AfpTrace();
+
+    void writeEvent(QJsonObject event, const QJsonObject &args);
+
+    int m_fd = -1;
+    qint64 m_pid = 0;
+    std::mutex m_mutex;
+    QString m_server;
+    QString m_volume;
+    QString m_path;
+};
+
+// Emits a span covering its own lifetime when tracing is enabled
+class TraceSpan {
+public:
+    TraceSpan(const char *category, const char *name)
+        : m_category(category)
+        , m_name(name)
+        , m_enabled(AfpTrace::instance().enabled())
+    {
+        if (m_enabled)
+            m_startUs = AfpTrace::nowUs();
+    }
+    ~TraceSpan()
+    {
+        if (m_enabled)
+            AfpTrace::instance().complete(m_category, m_name, m_startUs,
+                                          AfpTrace::nowUs() - m_startUs, m_args);
+    }
+
+    TraceSpan(const TraceSpan &) = delete;
+    TraceSpan &operator=(const TraceSpan &) = delete;
+
+    void setArg(const QString &key, const QJsonValue &value)
+    {
+        if (m_enabled)
+            m_args.insert(key, value);
+    }
+
+private:
+    const char *m_category;
+    const char *m_name;
+    bool m_enabled;
+    qint64 m_startUs = 0;
+    QJsonObject m_args;
+};
+
+#endif // KAFP_TRACE_H
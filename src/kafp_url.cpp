@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2025-2026 Daniel Markstedt <daniel@mindani.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include "kafp_url.h"
+
+#include <QUrl>
+#include <algorithm>
+#include <cstring>
+
+static bool isAscii(QStringView s)
+{
+    for (const QChar c : s) {
+        if (c.unicode() >= 0x80)
+            return false;
+    }
+    return true;
+}
+
+static bool isAscii(const char *s)
+{
+    for (; *s; ++s) {
+        if (static_cast<unsigned char>(*s) >= 0x80)
+            return false;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// AfpPathCodec
+// ---------------------------------------------------------------------------
+
+QByteArray AfpPathCodec::encodeName(QStringView name)
+{
+    if (isAscii(name))
+        return name.toLatin1();
+
+    const QString key = name.toString();
+    if (const auto it = m_encoded.constFind(key); it != m_encoded.constEnd())
+        return *it;
+
+    if (m_encoded.size() >= MAX_CACHE_ENTRIES)
+        m_encoded.clear();
+    const QByteArray encoded = key.normalized(QString::NormalizationForm_D).toUtf8();
+    m_encoded.insert(key, encoded);
+    return encoded;
+}
+
+QByteArray AfpPathCodec::encodePath(QStringView path)
+{
+    if (isAscii(path))
+        return path.toLatin1();
+
+    QByteArray encoded;
+    encoded.reserve(path.size() * 2);
+    qsizetype pos = 0;
+    while (pos <= path.size()) {
+        qsizetype end = path.indexOf(QLatin1Char('/'), pos);
+        if (end < 0)
+            end = path.size();
+        if (!encoded.isEmpty())
+            encoded += '/';
+        encoded += encodeName(path.mid(pos, end - pos));
+        pos = end + 1;
+    }
+    return encoded;
+}
+
+void AfpPathCodec::appendName(QStringView name, char *buf, size_t size, size_t &len)
+{
+    if (len + 1 >= size)
+        return;
+    buf[len++] = '/';
+
+    if (isAscii(name)) {
+        for (const QChar c : name) {
+            if (len + 1 >= size)
+                break;
+            buf[len++] = static_cast<char>(c.unicode());
+        }
+    } else {
+        const QByteArray encoded = encodeName(name);
+        size_t n = std::min(static_cast<size_t>(encoded.size()), size - 1 - len);
+        // Cut before a character rather than inside its UTF-8 sequence
+        while (n > 0 && n < static_cast<size_t>(encoded.size())
+               && (static_cast<unsigned char>(encoded[static_cast<qsizetype>(n)]) & 0xc0) == 0x80)
+            --n;
+        std::memcpy(buf + len, encoded.constData(), n);
+        len += n;
+    }
+    buf[len] = '\0';
+}
+
+QString AfpPathCodec::decodeName(const char *name)
+{
+    if (isAscii(name))
+        return QString::fromLatin1(name);
+
+    const QByteArray key(name);
+    if (const auto it = m_decoded.constFind(key); it != m_decoded.constEnd())
+        return *it;
+
+    if (m_decoded.size() >= MAX_CACHE_ENTRIES)
+        m_decoded.clear();
+    const QString decoded = QString::fromUtf8(key).normalized(QString::NormalizationForm_C);
+    m_decoded.insert(key, decoded);
+    return decoded;
+}
+
+// ---------------------------------------------------------------------------
+// URL parsing
+// ---------------------------------------------------------------------------
+
+// Copy s as UTF-8 into a fixed-size afp_url field, without a temporary
+// for the usual ASCII case
+static void copyField(char *dst, size_t size, QStringView s)
+{
+    if (isAscii(s)) {
+        const size_t n = std::min(static_cast<size_t>(s.size()), size - 1);
+        for (size_t i = 0; i < n; ++i)
+            dst[i] = static_cast<char>(s[static_cast<qsizetype>(i)].unicode());
+        dst[n] = '\0';
+    } else {
+        std::strncpy(dst, s.toUtf8().constData(), size - 1);
+    }
+}
+
+ParsedUrl parseAfpUrl(const QUrl &url, AfpPathCodec &codec)
+{
+    ParsedUrl pu {};
+    afp_default_url(&pu.afpUrl);
+
+    pu.server = url.host();
+    copyField(pu.afpUrl.servername, sizeof(pu.afpUrl.servername), pu.server);
+
+    if (url.port() > 0)
+        pu.afpUrl.port = url.port();
+
+    // Credentials from URL
+    if (const QString user = url.userName(); !user.isEmpty())
+        copyField(pu.afpUrl.username, sizeof(pu.afpUrl.username), user);
+    if (const QString pass = url.password(); !pass.isEmpty())
+        copyField(pu.afpUrl.password, sizeof(pu.afpUrl.password), pass);
+
+    // url.path() is e.g. "/VolumeName/some/dir/file": the first component
+    // is the volume, the rest is the path within it.  Walk it once,
+    // recording component offsets and writing the encoded server path
+    // straight into afp_url.
+    QString urlPath = url.path();
+    const qsizetype size = urlPath.size();
+    qsizetype pathStart = -1;
+    bool compact = true; // no empty components after the volume
+    size_t wireLen = 0;
+
+    qsizetype pos = 0;
+    while (pos < size) {
+        qsizetype end = urlPath.indexOf(QLatin1Char('/'), pos);
+        if (end < 0)
+            end = size;
+        if (end == pos) {
+            if (pathStart >= 0)
+                compact = false;
+        } else {
+            const QStringView component = QStringView(urlPath).mid(pos, end - pos);
+            if (!pu.hasVolume) {
+                pu.volume = component.toString();
+                pu.hasVolume = true;
+            } else {
+                if (pathStart < 0)
+                    pathStart = pos;
+                pu.components.append(pos - pathStart);
+                codec.appendName(component, pu.afpUrl.path, sizeof(pu.afpUrl.path), wireLen);
+            }
+        }
+        pos = end + 1;
+    }
+    if (pathStart >= 0 && urlPath.endsWith(QLatin1Char('/')))
+        compact = false;
+
+    if (pu.hasVolume)
+        copyField(pu.afpUrl.volumename, sizeof(pu.afpUrl.volumename), pu.volume);
+
+    if (pathStart >= 0) {
+        pu.hasPath = true;
+        if (compact) {
+            // Reuse url.path()'s buffer; we hold the only reference to it
+            urlPath.remove(0, pathStart);
+            pu.path = std::move(urlPath);
+        } else {
+            // Rebuild from the components, dropping empty ones
+            QString path;
+            path.reserve(size - pathStart);
+            const QStringView source(urlPath);
+            for (qsizetype &offset : pu.components) {
+                const qsizetype start = pathStart + offset;
+                qsizetype end = urlPath.indexOf(QLatin1Char('/'), start);
+                if (end < 0)
+                    end = size;
+                if (!path.isEmpty())
+                    path += QLatin1Char('/');
+                offset = path.size();
+                path += source.mid(start, end - start);
+            }
+            pu.path = std::move(path);
+        }
+    } else if (pu.hasVolume) {
+        // The volume root is always "/"
+        std::strncpy(pu.afpUrl.path, "/", sizeof(pu.afpUrl.path) - 1);
+    }
+
+    return pu;
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2025-2026 Daniel Markstedt <daniel@mindani.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef KAFP_URL_H
+#define KAFP_URL_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QStringView>
+#include <QVarLengthArray>
+#include <cstddef>
+
+class QUrl;
+
+extern "C" {
+#include <afp.h>
+}
+
+// Converts path names between the form KIO uses and the form sent to the
+// server.  AFP servers store and compare UTF-8 names decomposed (NFD),
+// while names typed or created on Linux are normally precomposed (NFC).
+// Pure-ASCII names, by far the most common, are the same in both forms
+// and skip normalization; other components are converted once and cached.
+class AfpPathCodec {
+public:
+    // One path component, as sent to the server
+    QByteArray encodeName(QStringView name);
+    // Append '/' and the encoded component to the NUL-terminated buffer
+    // buf of the given size, truncating at its end like strncpy() but on
+    // a character boundary
+    void appendName(QStringView name, char *buf, size_t size, size_t &len);
+    // A relative path of '/'-separated components, as sent to the server
+    QByteArray encodePath(QStringView path);
+    // A name received from the server, as shown to KIO
+    QString decodeName(const char *name);
+
+    // Each cache is cleared when it would grow beyond this
+    static constexpr qsizetype MAX_CACHE_ENTRIES = 2048;
+    qsizetype encodedCacheSize() const { return m_encoded.size(); }
+    qsizetype decodedCacheSize() const { return m_decoded.size(); }
+
+private:
+
+    QHash<QString, QByteArray> m_encoded; // NFC name -> NFD UTF-8
+    QHash<QByteArray, QString> m_decoded; // NFD UTF-8 -> NFC name
+};
+
+struct ParsedUrl {
+    struct afp_url afpUrl;
+    QString server;
+    QString volume;
+    QString path; // path within volume (no leading slash)
+    bool hasVolume;
+    bool hasPath;
+    // Offset of each component within path, so callers never re-split it
+    QVarLengthArray<qsizetype, 16> components;
+
+    // Last component of the path, or the volume name at the volume root
+    QStringView leafName() const
+    {
+        return components.isEmpty() ? QStringView(volume)
+                                    : QStringView(path).mid(components.last());
+    }
+};
+
+// Split an afp:// URL into server, volume and path, and fill in the
+// afp_url handed to libafpsl
+ParsedUrl parseAfpUrl(const QUrl &url, AfpPathCodec &codec);
+
+#endif // KAFP_URL_H
@@ -11,148 +11,183 @@
 #include <KIO/WorkerBase>
 #include <KLocalizedString>
 #include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDataStream>
 #include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QLoggingCategory>
 #include <QMimeDatabase>
+#include <QMimeType>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QSet>
 #include <QThread>
 #include <QUrl>
 
 #include <QStandardPaths>
+#include <algorithm>
 #include <cerrno>
-#include <csignal>
+#include <chrono>
+#include <condition_variable>
 #include <cstring>
+#include <deque>
 #include <fcntl.h>
+#include <functional>
 #include <grp.h>
+#include <memory>
+#include <mutex>
 #include <pwd.h>
 #include <sys/file.h>
 #include <sys/stat.h>
 #include <sys/statvfs.h>
+#include <thread>
 #include <unistd.h>
+#include <vector>
 
-extern "C" {
-#include <afp.h>
-#include <afp_server.h>
-#include <afpsl.h>
-}
+#include "kafp_trace.h"
+#include "kafp_worker.h"
 
 Q_LOGGING_CATEGORY(logAfp, "kio.afp")
 
 // Read buffer size for get/put operations (64 KiB)
 static constexpr unsigned int READ_CHUNK = 64 * 1024;
 
-struct ParsedUrl {
-    struct afp_url afpUrl;
-    QString server;
-    QString volume;
-    QString path; // path within volume (no leading slash)
-    bool hasVolume;
-    bool hasPath;
-};
+// Number of server/volume pairs remembered for volume warm-up
+static constexpr int MAX_RECENT_VOLUMES = 32;
 
-class AfpWorker : public KIO::WorkerBase {
-public:
-    AfpWorker(const QByteArray &pool, const QByteArray &app)
-        : KIO::WorkerBase("afp", pool, app)
-    {
-    }
-
-    KIO::WorkerResult stat(const QUrl &url) override;
-    KIO::WorkerResult listDir(const QUrl &url) override;
-    KIO::WorkerResult get(const QUrl &url) override;
-    KIO::WorkerResult put(const QUrl &url, int permissions, KIO::JobFlags flags) override;
-    KIO::WorkerResult mkdir(const QUrl &url, int permissions) override;
-    KIO::WorkerResult del(const QUrl &url, bool isFile) override;
-    KIO::WorkerResult rename(const QUrl &src, const QUrl &dest, KIO::JobFlags flags) override;
-    KIO::WorkerResult chmod(const QUrl &url, int permissions) override;
-    KIO::WorkerResult fileSystemFreeSpace(const QUrl &url) override;
-
-private:
-    // --- State ---
-    bool m_connSetupDone = false;
-    QString m_cachedServer;
-    serverid_t m_serverId = nullptr;
-    QString m_cachedVolume;
-    volumeid_t m_volumeId = nullptr;
-    QByteArray m_cachedUser;
-    QByteArray m_cachedPass;
-
-    // --- URL parsing ---
-    ParsedUrl parseAfpUrl(const QUrl &url) const;
-
-    // --- Connection lifecycle ---
-    KIO::WorkerResult ensureConnSetup();
-    KIO::WorkerResult ensureConnected(ParsedUrl &pu);
-    KIO::WorkerResult ensureAttached(ParsedUrl &pu);
-    void invalidateSessionState(const char *reason);
-    bool isRecoverableSessionError(int ret) const;
-
-    // --- UDSEntry helpers ---
-    KIO::UDSEntry statToUDS(const struct stat &st, const QString &name) const;
-    KIO::UDSEntry serverOrVolumeEntry(const QString &name) const;
-    KIO::UDSEntry volumeSummaryToUDS(const struct afp_volume_summary &vol) const;
-
-    // --- Error mapping ---
-    KIO::WorkerResult mapAfpError(int ret, const QString &path) const;
-    KIO::WorkerResult mapAfpConnectError(int ret, const QString &server) const;
-};
+// Volume lists are served from cache for VOLUME_LIST_TTL_MS, then served
+// stale while a background refresh runs, up to VOLUME_LIST_MAX_AGE_MS.
+static constexpr qint64 VOLUME_LIST_TTL_MS = 30 * 1000;
+static constexpr qint64 VOLUME_LIST_MAX_AGE_MS = 10 * 60 * 1000;
 
-// ---------------------------------------------------------------------------
-// URL parsing
-// ---------------------------------------------------------------------------
+// How long a volume-root stat answers stat() without asking the server
+static constexpr qint64 ROOT_STAT_TTL_MS = 60 * 1000;
 
-ParsedUrl AfpWorker::parseAfpUrl(const QUrl &url) const
+// Attributes seen in a listing or stat answer stat() and size get() for
+// PATH_ATTR_TTL_MS.  Past MAX_PATH_ATTR_ENTRIES the least recently used
+// directories are dropped; a listing caches its first LISTING_ATTR_ENTRIES.
+static constexpr qint64 PATH_ATTR_TTL_MS = 10 * 1000;
+static constexpr qsizetype MAX_PATH_ATTR_ENTRIES = 8192;
+static constexpr qsizetype LISTING_ATTR_ENTRIES = 2048;
+
+// MIME database, created on first use rather than per operation
+static const QMimeDatabase &mimeDatabase()
 {
-    ParsedUrl pu {};
-    afp_default_url(&pu.afpUrl);
+    static const QMimeDatabase db;
+    return db;
+}
+
+// Upper bound on cached file-name-extension to MIME type mappings
+static constexpr qsizetype MAX_MIME_CACHE_ENTRIES = 4096;
+
+// Globs under which a name's type may not follow from its last extension:
+// those bound to the start of the name, such as "CMakeLists.txt" or
+// "README*", by their fixed start; the last extensions of ones spanning
+// several, such as "gz" of "*.tar.gz"; and any other, such as "*.tar.*".
+struct MimeGlobExceptions {
+    QHash<QChar, QStringList> prefixes; // by lowercase first character
+    QSet<QString> extensions; // lowercase
+    QList<QRegularExpression> patterns;
+};
 
-    pu.server = url.host();
-    QByteArray serverBytes = pu.server.toUtf8();
-    std::strncpy(pu.afpUrl.servername, serverBytes.constData(),
-                 sizeof(pu.afpUrl.servername) - 1);
+static const MimeGlobExceptions &mimeGlobExceptions()
+{
+    static const MimeGlobExceptions exceptions = [] {
+        MimeGlobExceptions e;
+        const auto isWildcard = [](QChar c) {
+            return c == QLatin1Char('*') || c == QLatin1Char('?') || c == QLatin1Char('[');
+        };
+        const auto allTypes = mimeDatabase().allMimeTypes();
+        for (const QMimeType &type : allTypes) {
+            const QStringList globs = type.globPatterns();
+            for (const QString &glob : globs) {
+                if (glob.isEmpty())
+                    continue;
+                if (!isWildcard(glob.front())) {
+                    const auto end = std::find_if(glob.cbegin(), glob.cend(), isWildcard);
+                    e.prefixes[glob.front().toLower()] << glob.left(end - glob.cbegin());
+                    continue;
+                }
+                // "*.ext" and "*~" only look at the last extension
+                const qsizetype dot = glob.lastIndexOf(QLatin1Char('.'));
+                if (dot <= 1 && glob.lastIndexOf(QLatin1Char('*')) == 0)
+                    continue;
+                const auto last = std::find_if(glob.crbegin(), glob.crend(), isWildcard);
+                if (glob.crend() - last - 1 < dot)
+                    e.extensions.insert(glob.mid(dot + 1).toLower());
+                else
+                    e.patterns << QRegularExpression(QRegularExpression::wildcardToRegularExpression(glob),
+                                                     QRegularExpression::CaseInsensitiveOption);
+            }
+        }
+        return e;
+    }();
+    return exceptions;
+}
 
-    if (url.port() > 0)
-        pu.afpUrl.port = url.port();
+// Path of a coordination file shared by all workers of this user
+static QString runtimeFilePath(const QString &name)
+{
+    return QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation)
+        + QLatin1Char('/') + name;
+}
 
-    // Credentials from URL
-    if (QByteArray user = url.userName().toUtf8(); !user.isEmpty())
-        std::strncpy(pu.afpUrl.username, user.constData(),
-                     sizeof(pu.afpUrl.username) - 1);
-    if (QByteArray pass = url.password().toUtf8(); !pass.isEmpty())
-        std::strncpy(pu.afpUrl.password, pass.constData(),
-                     sizeof(pu.afpUrl.password) - 1);
+// Fetch the complete volume list of a server, paging through
+// afp_sl_getvols() so servers with many volumes are listed in full.
+static int getAllVolumes(struct afp_url *url, QList<struct afp_volume_summary> &volumes)
+{
+    constexpr unsigned int PAGE_SIZE = 64;
+    constexpr qsizetype MAX_VOLUMES = 4096;
+    struct afp_volume_summary page[PAGE_SIZE];
 
-    // Split path: first component is volume, rest is path within volume
-    // url.path() is e.g. "/VolumeName/some/dir/file"
-    if (const QStringList parts = url.path().split(QLatin1Char('/'), Qt::SkipEmptyParts);
-        !parts.isEmpty()) {
-        pu.volume = parts.at(0);
-        pu.hasVolume = true;
-        QByteArray volBytes = pu.volume.toUtf8();
-        std::strncpy(pu.afpUrl.volumename, volBytes.constData(),
-                     sizeof(pu.afpUrl.volumename) - 1);
-
-        if (parts.size() > 1) {
-            QStringList subParts = parts.mid(1);
-            pu.path = subParts.join(QLatin1Char('/'));
-            pu.hasPath = true;
-        }
-    }
+    volumes.clear();
+    while (volumes.size() < MAX_VOLUMES) {
+        unsigned int numVols = 0;
+        int ret = afpCall(AfpCall::GetVols, afp_sl_getvols, url, static_cast<unsigned int>(volumes.size()),
+                          PAGE_SIZE, &numVols, page);
+        qCDebug(logAfp) << "kio-afp: getvols start=" << volumes.size()
+                        << "returned" << ret << "numVols=" << numVols;
+        if (ret != AFP_SERVER_RESULT_OKAY)
+            return ret;
 
-    // Set the path field in afp_url (absolute path within volume)
-    if (QByteArray pathBytes = pu.path.toUtf8(); !pathBytes.isEmpty()) {
-        QByteArray absPath = QByteArray("/") + pathBytes;
-        std::strncpy(pu.afpUrl.path, absPath.constData(),
-                     sizeof(pu.afpUrl.path) - 1);
-    }
+        // A daemon that ignores the start index returns the first page again
+        if (!volumes.isEmpty() && numVols > 0
+            && std::strcmp(page[0].volume_name_printable,
+                           volumes.first().volume_name_printable)
+                == 0)
+            break;
 
-    // Normalize: volume root should always have path "/"
-    if (pu.hasVolume && !pu.hasPath) {
-        std::strncpy(pu.afpUrl.path, "/", sizeof(pu.afpUrl.path) - 1);
+        for (unsigned int i = 0; i < numVols; ++i)
+            volumes.append(page[i]);
+        if (numVols < PAGE_SIZE)
+            break;
     }
+    return AFP_SERVER_RESULT_OKAY;
+}
+
+// ---------------------------------------------------------------------------
+// URL parsing
+// ---------------------------------------------------------------------------
 
+ParsedUrl AfpWorker::parseAfpUrl(const QUrl &url)
+{
+    ParsedUrl pu = ::parseAfpUrl(url, m_pathCodec);
+    AfpStats::instance().setSession(pu.server, pu.volume);
+    AfpTrace::instance().setContext(pu.server, pu.volume, pu.path);
     return pu;
 }
 
+QString AfpWorker::volumeKey(const ParsedUrl &pu)
+{
+    return pu.server + QLatin1Char('/') + pu.volume;
+}
+
 // ---------------------------------------------------------------------------
 // Connection lifecycle
 // ---------------------------------------------------------------------------
@@ -169,19 +204,27 @@ KIO::WorkerResult AfpWorker::ensureConnSetup()
 
 KIO::WorkerResult AfpWorker::ensureConnected(ParsedUrl &pu)
 {
+    // Background work keeps running next to this operation, unless the
+    // session is about to change under it (below)
+    reapBackground();
+
     if (auto r = ensureConnSetup(); !r.success())
         return r;
 
+    if (auto r = reapPendingConnect(pu); !r.success())
+        return r;
+
     // If we're already connected to a different server, disconnect first
     if (m_serverId && m_cachedServer != pu.server) {
         qCDebug(logAfp) << "kio-afp: disconnecting from" << m_cachedServer;
-        afp_sl_disconnect(&m_serverId);
-        m_serverId = nullptr;
+        waitForBackground();
+        releaseSession();
         m_cachedServer.clear();
         m_cachedUser.clear();
         m_cachedPass.clear();
         m_volumeId = nullptr;
         m_cachedVolume.clear();
+        m_attachedVolumes.clear();
     }
 
     if (m_serverId) {
@@ -196,6 +239,9 @@ KIO::WorkerResult AfpWorker::ensureConnected(ParsedUrl &pu)
         return KIO::WorkerResult::pass();
     }
 
+    // No background work may overlap a connect
+    waitForBackground();
+
     // Set up AuthInfo for credential caching / password dialog
     KIO::AuthInfo info;
     info.url.setScheme(QStringLiteral("afp"));
@@ -229,6 +275,13 @@ KIO::WorkerResult AfpWorker::ensureConnected(ParsedUrl &pu)
         haveCreds = !info.username.isEmpty() && !info.password.isEmpty();
     }
 
+    // A sibling worker may already hold an authenticated session for this
+    // server and user in afpsld; adopting it skips the login and connect lock.
+    if (adoptSharedSession(pu)) {
+        startBackgroundRefresh(pu, false);
+        return KIO::WorkerResult::pass();
+    }
+
     // No credentials from URL or cache — prompt before connecting
     if (!haveCreds) {
         info.setModified(false);
@@ -258,6 +311,7 @@ KIO::WorkerResult AfpWorker::ensureConnected(ParsedUrl &pu)
             age < BREAKER_COOLDOWN_SECS) {
             qWarning() << "kio-afp: connect circuit breaker active ("
                        << age << "s ago), failing fast";
+            AfpStats::instance().recordBreakerReject();
             return KIO::WorkerResult::fail(KIO::ERR_CANNOT_CONNECT,
                                            i18n("AFP daemon not responding (retry in %1 s)",
                                                 BREAKER_COOLDOWN_SECS - static_cast<int>(age)));
@@ -269,8 +323,10 @@ KIO::WorkerResult AfpWorker::ensureConnected(ParsedUrl &pu)
     // Serialize afp_sl_connect (including retries) across worker processes
     // to avoid overwhelming the afpsld daemon with concurrent connections.
     int lockFd = ::open(lockPath.constData(), O_CREAT | O_RDWR, 0600);
-    if (lockFd >= 0)
+    if (lockFd >= 0) {
+        const TraceSpan wait("lock", "kio-afp-connect.lock");
         flock(lockFd, LOCK_EX);
+    }
 
     // After acquiring the lock, check the breaker again — the worker ahead
     // of us may have tripped it while we were waiting.
@@ -278,6 +334,7 @@ KIO::WorkerResult AfpWorker::ensureConnected(ParsedUrl &pu)
         if (time_t age = time(nullptr) - breakerSt.st_mtime;
             age < BREAKER_COOLDOWN_SECS) {
             qWarning() << "kio-afp: connect circuit breaker tripped while waiting";
+            AfpStats::instance().recordBreakerReject();
             if (lockFd >= 0)
                 ::close(lockFd);
             return KIO::WorkerResult::fail(KIO::ERR_CANNOT_CONNECT,
@@ -290,29 +347,51 @@ KIO::WorkerResult AfpWorker::ensureConnected(ParsedUrl &pu)
     // Connect / retry loop
     constexpr int MAX_CONNECT_RETRIES = 3;
     constexpr int BASE_RETRY_DELAY_MS = 500;
-    constexpr unsigned int CONNECT_TIMEOUT_SECS = 15;
+    constexpr std::chrono::seconds CONNECT_TIMEOUT(15);
     int transientRetries = 0;
 
     for (;;) {
-        serverid_t sid = nullptr;
-        char loginmesg[AFP_LOGINMESG_LEN] = {};
-        int connectError = 0;
         unsigned int uamMask = default_uams_mask();
 
-        // Hard timeout: if afp_sl_connect busy-loops inside the library,
-        // SIGALRM will terminate this worker process so it doesn't spin
-        // at 100% CPU forever.  KIO will clean up and show an error.
-        std::signal(SIGALRM, SIG_DFL);
-        alarm(CONNECT_TIMEOUT_SECS);
-
         qCDebug(logAfp) << "kio-afp: connect server=" << pu.server
                         << "user=" << pu.afpUrl.username;
-        int ret = afp_sl_connect(&pu.afpUrl, uamMask, &sid, loginmesg,
-                                 &connectError);
 
-        alarm(0); // cancel timeout — connect returned normally
+        // afp_sl_connect() can block indefinitely inside the library, so run
+        // it on a helper thread and give up after a deadline or when the job
+        // is killed.  The worker process and its cached state stay alive.
+        std::shared_ptr<ConnectAttempt> attempt = startConnect(pu, uamMask);
+        if (ConnectWait wait = waitForConnect(*attempt, CONNECT_TIMEOUT);
+            wait != ConnectWait::Finished) {
+            // The attempt keeps running in the background and is reaped
+            // by the next ensureConnected() call.
+            m_pendingConnect = attempt;
+            if (lockFd >= 0)
+                ::close(lockFd);
+
+            if (wait == ConnectWait::Cancelled) {
+                qCDebug(logAfp) << "kio-afp: connect cancelled";
+                return KIO::WorkerResult::fail(KIO::ERR_USER_CANCELED, pu.server);
+            }
+
+            qWarning() << "kio-afp: connect timed out after"
+                       << CONNECT_TIMEOUT.count() << "s, tripping circuit breaker";
+            AfpTrace::instance().instant("retry", "circuit breaker tripped",
+                                         QJsonObject { { QStringLiteral("reason"), QStringLiteral("timeout") } });
+            AfpStats::instance().recordBreakerTrip();
+            if (int bfd = ::open(breakerPath.constData(), O_CREAT | O_WRONLY, 0600);
+                bfd >= 0)
+                ::close(bfd);
+            return mapAfpConnectError(AFP_SERVER_RESULT_TIMEDOUT, pu.server);
+        }
+
+        // The connect ran on its own thread, but for this operation
+        AfpStats::attributeCall();
+
+        serverid_t sid = attempt->sid;
+        int ret = attempt->ret;
+        const char *loginmesg = attempt->loginmesg;
         qCDebug(logAfp) << "kio-afp: connect returned" << ret
-                        << "sid=" << sid << "err=" << connectError;
+                        << "sid=" << sid << "err=" << attempt->connectError;
 
         // Sanity check: if success reported but no session ID, treat as daemon error
         if ((ret == AFP_SERVER_RESULT_OKAY || ret == AFP_SERVER_RESULT_ALREADY_CONNECTED) && !sid) {
@@ -328,10 +407,16 @@ KIO::WorkerResult AfpWorker::ensureConnected(ParsedUrl &pu)
             // Successful connect clears any stale breaker
             ::unlink(breakerPath.constData());
 
+            // ALREADY_CONNECTED hands back a session another worker logged
+            // in, which stays open after we are done with it
             m_serverId = sid;
+            m_sessionAdopted = ret == AFP_SERVER_RESULT_ALREADY_CONNECTED;
             m_cachedServer = pu.server;
             m_cachedUser = QByteArray(pu.afpUrl.username);
             m_cachedPass = QByteArray(pu.afpUrl.password);
+            if (!m_sessionAdopted)
+                publishSharedSession();
+            startBackgroundRefresh(pu, false);
 
             if (loginmesg[0] != '\0')
                 qCDebug(logAfp) << "kio-afp: login message:" << loginmesg;
@@ -370,8 +455,10 @@ KIO::WorkerResult AfpWorker::ensureConnected(ParsedUrl &pu)
 
             // Re-acquire lock before next attempt
             lockFd = ::open(lockPath.constData(), O_CREAT | O_RDWR, 0600);
-            if (lockFd >= 0)
+            if (lockFd >= 0) {
+                const TraceSpan wait("lock", "kio-afp-connect.lock");
                 flock(lockFd, LOCK_EX);
+            }
             continue;
         }
 
@@ -383,7 +470,13 @@ KIO::WorkerResult AfpWorker::ensureConnected(ParsedUrl &pu)
                        << "), retrying in" << delay << "ms (attempt"
                        << (transientRetries + 1) << "of"
                        << MAX_CONNECT_RETRIES << ")";
-            QThread::msleep(delay);
+            {
+                TraceSpan backoff("retry", "connect backoff");
+                backoff.setArg(QStringLiteral("attempt"), transientRetries + 1);
+                backoff.setArg(QStringLiteral("ret"), ret);
+                QThread::msleep(delay);
+            }
+            AfpStats::instance().recordRetry();
             ++transientRetries;
             continue;
         }
@@ -392,6 +485,9 @@ KIO::WorkerResult AfpWorker::ensureConnected(ParsedUrl &pu)
         // workers fail fast instead of also hammering the daemon.
         qWarning() << "kio-afp: tripping connect circuit breaker for"
                    << BREAKER_COOLDOWN_SECS << "s";
+        AfpTrace::instance().instant("retry", "circuit breaker tripped",
+                                     QJsonObject { { QStringLiteral("ret"), ret } });
+        AfpStats::instance().recordBreakerTrip();
         if (int bfd = ::open(breakerPath.constData(), O_CREAT | O_WRONLY, 0600);
             bfd >= 0)
             ::close(bfd);
@@ -402,6 +498,104 @@ KIO::WorkerResult AfpWorker::ensureConnected(ParsedUrl &pu)
     }
 }
 
+std::shared_ptr<ConnectAttempt> AfpWorker::startConnect(const ParsedUrl &pu,
+                                                        unsigned int uamMask)
+{
+    auto attempt = std::make_shared<ConnectAttempt>();
+    attempt->url = pu.afpUrl;
+    attempt->uamMask = uamMask;
+
+    std::thread([attempt, server = pu.server] {
+        AfpStats::instance().setSession(server, QString());
+        serverid_t sid = nullptr;
+        char loginmesg[AFP_LOGINMESG_LEN] = {};
+        int connectError = 0;
+        int ret = afpCall(AfpCall::Connect, afp_sl_connect, &attempt->url, attempt->uamMask, &sid,
+                          loginmesg, &connectError);
+
+        std::lock_guard<std::mutex> lock(attempt->mutex);
+        attempt->sid = sid;
+        std::memcpy(attempt->loginmesg, loginmesg, sizeof(attempt->loginmesg));
+        attempt->connectError = connectError;
+        attempt->ret = ret;
+        attempt->finished = true;
+        attempt->done.notify_all();
+    }).detach();
+
+    return attempt;
+}
+
+AfpWorker::ConnectWait AfpWorker::waitForConnect(ConnectAttempt &attempt,
+                                                 std::chrono::seconds timeout)
+{
+    // Wake up periodically so that a killed job is noticed promptly;
+    // KIO only gives a worker a few seconds to exit after SIGTERM.
+    constexpr std::chrono::milliseconds POLL_INTERVAL(100);
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+
+    std::unique_lock<std::mutex> lock(attempt.mutex);
+    while (!attempt.finished) {
+        if (jobKilled())
+            return ConnectWait::Cancelled;
+
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= deadline)
+            return ConnectWait::TimedOut;
+
+        attempt.done.wait_for(lock, std::min<std::chrono::steady_clock::duration>(
+                                        POLL_INTERVAL, deadline - now));
+    }
+    return ConnectWait::Finished;
+}
+
+KIO::WorkerResult AfpWorker::reapPendingConnect(const ParsedUrl &pu)
+{
+    if (!m_pendingConnect)
+        return KIO::WorkerResult::pass();
+
+    const std::shared_ptr<ConnectAttempt> attempt = m_pendingConnect;
+    std::lock_guard<std::mutex> lock(attempt->mutex);
+    const QString server = QString::fromUtf8(attempt->url.servername);
+
+    // libafpsl shares one daemon socket per process; issuing another call
+    // while the abandoned connect is still blocked would interleave replies.
+    if (!attempt->finished) {
+        qWarning() << "kio-afp: earlier connect to" << server << "still pending";
+        return KIO::WorkerResult::fail(KIO::ERR_SERVER_TIMEOUT,
+                                       i18n("A previous connection attempt to %1 is still in progress", server));
+    }
+    m_pendingConnect.reset();
+
+    qCDebug(logAfp) << "kio-afp: abandoned connect to" << server
+                    << "finished with" << attempt->ret << "sid=" << attempt->sid;
+
+    const bool succeeded = (attempt->ret == AFP_SERVER_RESULT_OKAY
+                            || attempt->ret == AFP_SERVER_RESULT_ALREADY_CONNECTED)
+        && attempt->sid;
+    // Only for the user it logged in as; a URL without one may be about to
+    // log in as someone else with credentials from the wallet
+    const bool sameUser = std::strcmp(pu.afpUrl.username, attempt->url.username) == 0;
+
+    // A late success for the server we are about to use saves a full login
+    if (succeeded && !m_serverId && server == pu.server && sameUser) {
+        qCDebug(logAfp) << "kio-afp: adopting late connection to" << server;
+        m_serverId = attempt->sid;
+        m_sessionAdopted = attempt->ret == AFP_SERVER_RESULT_ALREADY_CONNECTED;
+        m_cachedServer = server;
+        m_cachedUser = QByteArray(attempt->url.username);
+        m_cachedPass = QByteArray(attempt->url.password);
+    } else if (attempt->ret == AFP_SERVER_RESULT_OKAY && attempt->sid
+               && attempt->sid != m_serverId) {
+        // Nobody will use this session; don't leave it open in afpsld.
+        // ALREADY_CONNECTED means it predates the attempt and has an owner.
+        qCDebug(logAfp) << "kio-afp: closing unused late connection to" << server;
+        serverid_t sid = attempt->sid;
+        afpCall(AfpCall::Disconnect, afp_sl_disconnect, &sid);
+    }
+
+    return KIO::WorkerResult::pass();
+}
+
 KIO::WorkerResult AfpWorker::ensureAttached(ParsedUrl &pu)
 {
     if (!pu.hasVolume)
@@ -411,7 +605,8 @@ KIO::WorkerResult AfpWorker::ensureAttached(ParsedUrl &pu)
     if (auto r = ensureConnected(pu); !r.success())
         return r;
 
-    // If switching to a different volume, clear our local cache.
+    // If switching to a different volume, reuse a handle attached earlier
+    // (possibly by the warm-up stage) or clear our local cache.
     // Don't call afp_sl_detach — the daemon handles concurrent volume
     // attachments, and detaching with a mismatched URL corrupts state.
     if (m_volumeId && m_cachedVolume != pu.volume) {
@@ -421,13 +616,26 @@ KIO::WorkerResult AfpWorker::ensureAttached(ParsedUrl &pu)
         m_cachedVolume.clear();
     }
 
+    // The warm-up may be attaching this very volume: wait for that call
+    // rather than racing it with a second attach, and drop the rest
+    if (m_backgroundVolumes.contains(pu.volume))
+        waitForBackground();
+
+    if (!m_volumeId) {
+        if (const auto it = m_attachedVolumes.constFind(pu.volume);
+            it != m_attachedVolumes.constEnd()) {
+            m_volumeId = it.value();
+            m_cachedVolume = pu.volume;
+        }
+    }
+
     if (m_volumeId)
         return KIO::WorkerResult::pass();
 
     volumeid_t vid = nullptr;
 
     qCDebug(logAfp) << "kio-afp: attach volume=" << pu.volume;
-    int ret = afp_sl_attach(&pu.afpUrl, 0, &vid);
+    int ret = afpCall(AfpCall::Attach, afp_sl_attach, &pu.afpUrl, 0, &vid);
     qCDebug(logAfp) << "kio-afp: attach returned" << ret << "vid=" << vid;
 
     if (ret == AFP_SERVER_RESULT_ALREADY_MOUNTED
@@ -435,7 +643,7 @@ KIO::WorkerResult AfpWorker::ensureAttached(ParsedUrl &pu)
         // Volume attached but daemon didn't return a handle.
         // Try to retrieve it, or reset the connection and re-attach.
         qCDebug(logAfp) << "kio-afp: volume already attached, trying getvolid";
-        ret = afp_sl_getvolid(&pu.afpUrl, &vid);
+        ret = afpCall(AfpCall::GetVolId, afp_sl_getvolid, &pu.afpUrl, &vid);
         qCDebug(logAfp) << "kio-afp: getvolid returned" << ret << "vid=" << vid;
 
         if (ret != AFP_SERVER_RESULT_OKAY) {
@@ -443,15 +651,16 @@ KIO::WorkerResult AfpWorker::ensureAttached(ParsedUrl &pu)
             // server connection owns it.  Disconnect to clean up,
             // then reconnect and re-attach.
             qWarning() << "kio-afp: getvolid failed, resetting connection";
-            afp_sl_disconnect(&m_serverId);
-            m_serverId = nullptr;
+            waitForBackground();
+            releaseSession();
             m_cachedServer.clear();
+            m_attachedVolumes.clear();
 
             if (auto rc = ensureConnected(pu); !rc.success())
                 return rc;
 
             vid = nullptr;
-            ret = afp_sl_attach(&pu.afpUrl, 0, &vid);
+            ret = afpCall(AfpCall::Attach, afp_sl_attach, &pu.afpUrl, 0, &vid);
             qCDebug(logAfp) << "kio-afp: re-attach after reset returned" << ret
                             << "vid=" << vid;
 
@@ -459,7 +668,7 @@ KIO::WorkerResult AfpWorker::ensureAttached(ParsedUrl &pu)
             // disconnect and re-attach; try getvolid once more.
             if (ret == AFP_SERVER_RESULT_ALREADY_MOUNTED
                 || ret == AFP_SERVER_RESULT_ALREADY_ATTACHED) {
-                ret = afp_sl_getvolid(&pu.afpUrl, &vid);
+                ret = afpCall(AfpCall::GetVolId, afp_sl_getvolid, &pu.afpUrl, &vid);
                 qCDebug(logAfp) << "kio-afp: getvolid retry returned" << ret
                                 << "vid=" << vid;
             }
@@ -473,23 +682,39 @@ KIO::WorkerResult AfpWorker::ensureAttached(ParsedUrl &pu)
 
     m_volumeId = vid;
     m_cachedVolume = pu.volume;
+    m_attachedVolumes.insert(pu.volume, vid);
+    rememberVolume(pu.server, pu.volume);
     return KIO::WorkerResult::pass();
 }
 
 void AfpWorker::invalidateSessionState(const char *reason)
 {
     qCDebug(logAfp) << "kio-afp: invalidating cached AFP session state:" << reason;
+    // Every caller retries the failed call afterwards
+    AfpStats::instance().recordReconnect();
+    AfpTrace::instance().instant("retry", "session reset",
+                                 QJsonObject { { QStringLiteral("reason"), QLatin1String(reason) } });
+    waitForBackground();
+    releaseSession();
 
-    if (m_serverId) {
-        afp_sl_disconnect(&m_serverId);
-    }
-
-    m_serverId = nullptr;
     m_cachedServer.clear();
     m_cachedUser.clear();
     m_cachedPass.clear();
     m_volumeId = nullptr;
     m_cachedVolume.clear();
+    m_attachedVolumes.clear();
+}
+
+void AfpWorker::releaseSession()
+{
+    // Only the worker that logged in closes the session; one adopted from a
+    // sibling is still in use there, so just forget the handle
+    if (m_serverId && !m_sessionAdopted) {
+        withdrawSharedSession();
+        afpCall(AfpCall::Disconnect, afp_sl_disconnect, &m_serverId);
+    }
+    m_serverId = nullptr;
+    m_sessionAdopted = false;
 }
 
 bool AfpWorker::isRecoverableSessionError(int ret) const
@@ -506,6 +731,492 @@ bool AfpWorker::isRecoverableSessionError(int ret) const
     }
 }
 
+// ---------------------------------------------------------------------------
+// Session handoff between worker processes
+// ---------------------------------------------------------------------------
+
+// A worker that logged in publishes its afpsld session handle in a record
+// under the user's private runtime directory.  Records never contain the
+// password; a worker that adopts one is trusted because it runs as the
+// same user that authenticated.
+//
+// libafpsl addresses sessions by server and user name; the handle is only
+// taken by afp_sl_disconnect().  An adopting worker therefore never passes
+// the recorded handle to libafpsl: it keeps it to mark itself connected,
+// and leaves closing the session and withdrawing the record to the owner.
+
+QString AfpWorker::sharedSessionPath(const QString &server)
+{
+    const QByteArray key = QCryptographicHash::hash(server.toUtf8(),
+                                                    QCryptographicHash::Sha1)
+                               .toHex();
+    return runtimeFilePath(QStringLiteral("kio-afp/session-") + QString::fromLatin1(key));
+}
+
+bool AfpWorker::adoptSharedSession(ParsedUrl &pu)
+{
+    // Only a session of the user this URL logs in as, never a guess
+    if (pu.afpUrl.username[0] == '\0')
+        return false;
+
+    const QString path = sharedSessionPath(pu.server);
+    QFile file(path);
+    if (QFileInfo(file).ownerId() != getuid() || !file.open(QIODevice::ReadOnly))
+        return false;
+
+    serverid_t sid = nullptr;
+    QByteArray user;
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine().trimmed();
+        if (line.startsWith("sid=")) {
+            bool ok = false;
+            sid = reinterpret_cast<serverid_t>(static_cast<quintptr>(line.mid(4).toULongLong(&ok, 16)));
+            if (!ok)
+                sid = nullptr;
+        } else if (line.startsWith("user=")) {
+            user = line.mid(5);
+        }
+    }
+    if (!sid || user != pu.afpUrl.username)
+        return false;
+
+    // Make sure afpsld still has a session for this server and user, the
+    // one every later call of ours is routed to
+    struct afp_volume_summary probe {};
+    unsigned int numVols = 0;
+    if (int ret = afpCall(AfpCall::GetVols, afp_sl_getvols, &pu.afpUrl, 0, 1, &numVols, &probe);
+        ret != AFP_SERVER_RESULT_OKAY) {
+        qCDebug(logAfp) << "kio-afp: shared session for" << pu.server
+                        << "is stale, ret=" << ret;
+        QFile::remove(path);
+        return false;
+    }
+
+    qCDebug(logAfp) << "kio-afp: adopted shared session for" << pu.server
+                    << "user=" << user << "sid=" << sid;
+    m_serverId = sid;
+    m_sessionAdopted = true;
+    m_cachedServer = pu.server;
+    m_cachedUser = user;
+    m_cachedPass = QByteArray(pu.afpUrl.password);
+    return true;
+}
+
+void AfpWorker::publishSharedSession() const
+{
+    const QString path = sharedSessionPath(m_cachedServer);
+    if (!QDir().mkpath(QFileInfo(path).path()))
+        return;
+    QFile::setPermissions(QFileInfo(path).path(),
+                          QFileDevice::ReadOwner | QFileDevice::WriteOwner | QFileDevice::ExeOwner);
+
+    QSaveFile out(path);
+    if (!out.open(QIODevice::WriteOnly))
+        return;
+    out.write("sid=" + QByteArray::number(reinterpret_cast<quintptr>(m_serverId), 16) + '\n');
+    out.write("user=" + m_cachedUser + '\n');
+    if (out.commit())
+        QFile::setPermissions(path, QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+}
+
+void AfpWorker::withdrawSharedSession() const
+{
+    // Only remove the record if it still describes our session
+    const QString path = sharedSessionPath(m_cachedServer);
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+    const QByteArray ours = "sid=" + QByteArray::number(reinterpret_cast<quintptr>(m_serverId), 16);
+    if (file.readLine().trimmed() == ours)
+        QFile::remove(path);
+}
+
+// ---------------------------------------------------------------------------
+// Background work / volume warm-up
+// ---------------------------------------------------------------------------
+
+AfpWorker::~AfpWorker()
+{
+    waitForBackground();
+    AfpStats::instance().removeFile();
+}
+
+void AfpWorker::startBackground(std::function<std::function<void()>()> task)
+{
+    waitForBackground();
+    m_cancelBackground = false;
+    m_backgroundDone = false;
+    m_background = std::thread([this, task = std::move(task)] {
+        m_backgroundApply = task();
+        m_backgroundDone = true;
+    });
+}
+
+void AfpWorker::waitForBackground()
+{
+    if (!m_background.joinable())
+        return;
+
+    // Tasks check the flag between calls; afpTransfer() lets the worker
+    // thread in right after the call in flight
+    m_cancelBackground = true;
+    m_background.join();
+    m_backgroundVolumes.clear();
+    if (m_backgroundApply) {
+        m_backgroundApply();
+        m_backgroundApply = nullptr;
+    }
+}
+
+void AfpWorker::reapBackground()
+{
+    if (m_background.joinable() && m_backgroundDone)
+        waitForBackground();
+}
+
+QStringList AfpWorker::recentVolumes(const QString &server) const
+{
+    QStringList volumes;
+    QFile file(runtimeFilePath(QStringLiteral("kio-afp-recent-volumes")));
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return volumes;
+
+    while (!file.atEnd()) {
+        const QString line = QString::fromUtf8(file.readLine()).trimmed();
+        if (const qsizetype tab = line.indexOf(QLatin1Char('\t'));
+            tab > 0 && QStringView(line).left(tab) == server)
+            volumes << line.mid(tab + 1);
+    }
+    return volumes;
+}
+
+void AfpWorker::rememberVolume(const QString &server, const QString &volume) const
+{
+    const QString path = runtimeFilePath(QStringLiteral("kio-afp-recent-volumes"));
+    const QString entry = server + QLatin1Char('\t') + volume;
+
+    // Most recently used first; concurrent workers may race here, which
+    // at worst loses an entry.
+    QStringList lines {entry};
+    if (QFile file(path); file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        // Nothing to do if this volume is already the most recent one
+        if (QString::fromUtf8(file.readLine()).trimmed() == entry)
+            return;
+        file.seek(0);
+        while (!file.atEnd() && lines.size() < MAX_RECENT_VOLUMES) {
+            const QString line = QString::fromUtf8(file.readLine()).trimmed();
+            if (!line.isEmpty() && line != entry)
+                lines << line;
+        }
+    }
+
+    QSaveFile out(path);
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Text))
+        return;
+    out.write(lines.join(QLatin1Char('\n')).toUtf8() + '\n');
+    out.commit();
+}
+
+void AfpWorker::startBackgroundRefresh(const ParsedUrl &pu, bool refreshVolumeList)
+{
+    // Picks up what an earlier warm-up attached before choosing targets
+    waitForBackground();
+
+    QStringList targets;
+    if (const int maxVolumes = settingValue(QStringLiteral("WarmUpVolumes"), 0);
+        maxVolumes > 0) {
+        // Right after connecting the volume list may not be known yet; a
+        // volume that is gone just fails to attach
+        const auto list = m_volumeLists.constFind(pu.server);
+        QStringList available;
+        if (list != m_volumeLists.constEnd()) {
+            for (const struct afp_volume_summary &vol : list->volumes)
+                available << QString::fromUtf8(vol.volume_name_printable);
+        }
+
+        for (const QString &volume : recentVolumes(pu.server)) {
+            if (targets.size() >= maxVolumes)
+                break;
+            // The operation in progress attaches its own volume
+            if (pu.hasVolume && volume == pu.volume)
+                continue;
+            if ((list == m_volumeLists.constEnd() || available.contains(volume))
+                && !m_attachedVolumes.contains(volume))
+                targets << volume;
+        }
+    }
+    if (targets.isEmpty() && !refreshVolumeList)
+        return;
+
+    qCDebug(logAfp) << "kio-afp: background refresh volumes=" << refreshVolumeList
+                    << "warm-up" << targets;
+
+    // Runs from the connect and while the user is looking at the volume
+    // list: refresh a stale list and pre-attach recently used volumes, so
+    // the first click into one of them skips the attach round trip.
+    startBackground([this, url = pu.afpUrl, server = pu.server, targets,
+                     refreshVolumeList]() mutable {
+        AfpStats::instance().setSession(server, QString());
+        QList<struct afp_volume_summary> refreshed;
+        const bool listOk = refreshVolumeList && !m_cancelBackground
+            && getAllVolumes(&url, refreshed) == AFP_SERVER_RESULT_OKAY
+            && !refreshed.isEmpty();
+
+        QHash<QString, volumeid_t> attached;
+        for (const QString &volume : targets) {
+            if (m_cancelBackground)
+                break;
+            const QByteArray name = volume.toUtf8();
+            std::memset(url.volumename, 0, sizeof(url.volumename));
+            std::strncpy(url.volumename, name.constData(), sizeof(url.volumename) - 1);
+            std::memset(url.path, 0, sizeof(url.path));
+            std::strncpy(url.path, "/", sizeof(url.path) - 1);
+
+            AfpStats::instance().setSession(server, volume);
+            volumeid_t vid = nullptr;
+            int ret = afpCall(AfpCall::Attach, afp_sl_attach, &url, 0, &vid);
+            if (ret == AFP_SERVER_RESULT_ALREADY_MOUNTED
+                || ret == AFP_SERVER_RESULT_ALREADY_ATTACHED)
+                ret = afpCall(AfpCall::GetVolId, afp_sl_getvolid, &url, &vid);
+            qCDebug(logAfp) << "kio-afp: warm-up attach volume=" << volume
+                            << "returned" << ret << "vid=" << vid;
+            if (ret == AFP_SERVER_RESULT_OKAY && vid)
+                attached.insert(volume, vid);
+        }
+
+        return std::function<void()>([this, server, attached, listOk, refreshed] {
+            if (listOk) {
+                VolumeListCache &cache = m_volumeLists[server];
+                cache.volumes = refreshed;
+                cache.age.start();
+            }
+            if (m_cachedServer != server)
+                return;
+            for (auto it = attached.cbegin(); it != attached.cend(); ++it) {
+                if (!m_attachedVolumes.contains(it.key()))
+                    m_attachedVolumes.insert(it.key(), it.value());
+            }
+        });
+    });
+    m_backgroundVolumes = targets;
+}
+
+// ---------------------------------------------------------------------------
+// Volume root attributes
+// ---------------------------------------------------------------------------
+
+void AfpWorker::cacheRootStat(const ParsedUrl &pu, const struct stat &st)
+{
+    RootStatCache &cache = m_rootStats[volumeKey(pu)];
+    cache.st = st;
+    cache.age.start();
+}
+
+bool AfpWorker::cachedRootStat(const ParsedUrl &pu, struct stat &st) const
+{
+    const auto it = m_rootStats.constFind(volumeKey(pu));
+    if (it == m_rootStats.constEnd() || it->age.elapsed() > ROOT_STAT_TTL_MS)
+        return false;
+    st = it->st;
+    return true;
+}
+
+void AfpWorker::invalidateRootStat(const ParsedUrl &pu)
+{
+    // Only entries directly below the root change its modification time
+    if (pu.components.size() <= 1)
+        m_rootStats.remove(volumeKey(pu));
+}
+
+bool AfpWorker::volumeIsListed(const ParsedUrl &pu) const
+{
+    const auto it = m_volumeLists.constFind(pu.server);
+    if (it == m_volumeLists.constEnd())
+        return false;
+
+    const QByteArray name = pu.volume.toUtf8();
+    for (const struct afp_volume_summary &vol : it->volumes) {
+        if (name == vol.volume_name_printable)
+            return true;
+    }
+    return false;
+}
+
+// ---------------------------------------------------------------------------
+// Path attributes
+// ---------------------------------------------------------------------------
+
+// afpsl addresses everything by path, so the server resolves every
+// component on each request.  Remembering what listings already told us
+// lets stat() after listDir() and the size lookup in get() skip that
+// round trip entirely.
+
+QString AfpWorker::dirKey(const ParsedUrl &pu, QStringView dir) const
+{
+    return volumeKey(pu) + QLatin1Char('/') + dir;
+}
+
+QString AfpWorker::parentKey(const ParsedUrl &pu) const
+{
+    return dirKey(pu, pu.components.size() > 1
+                      ? QStringView(pu.path).left(pu.components.last() - 1)
+                      : QStringView());
+}
+
+DirAttrCache *AfpWorker::dirAttrs(const QString &key, qsizetype adding)
+{
+    // Make room by dropping whole directories, least recently used first
+    while (m_pathAttrCount + adding > MAX_PATH_ATTR_ENTRIES) {
+        auto oldest = m_pathAttrs.end();
+        for (auto it = m_pathAttrs.begin(); it != m_pathAttrs.end(); ++it) {
+            if (it.key() != key && (oldest == m_pathAttrs.end() || it->lastUse < oldest->lastUse))
+                oldest = it;
+        }
+        if (oldest == m_pathAttrs.end())
+            return nullptr;
+        m_pathAttrCount -= oldest->entries.size();
+        m_pathAttrs.erase(oldest);
+    }
+
+    DirAttrCache &dir = m_pathAttrs[key];
+    dir.lastUse = ++m_pathAttrUses;
+    return &dir;
+}
+
+void AfpWorker::cachePathAttrs(const ParsedUrl &pu, const struct stat &st)
+{
+    DirAttrCache *dir = dirAttrs(parentKey(pu), 1);
+    if (!dir)
+        return;
+    const qsizetype before = dir->entries.size();
+    PathAttrCache &cache = dir->entries[pu.leafName().toString()];
+    cache.st = st;
+    cache.age.start();
+    m_pathAttrCount += dir->entries.size() - before;
+}
+
+void AfpWorker::cacheListedAttrs(const QString &key, const struct afp_file_info_basic *fpb,
+                                 const KIO::UDSEntryList &entries, qsizetype count)
+{
+    DirAttrCache *dir = dirAttrs(key, count);
+    if (!dir)
+        return;
+    const qsizetype before = dir->entries.size();
+    for (qsizetype i = 0; i < count; ++i) {
+        // Same type mapping as fileInfoToUDS()
+        const struct afp_file_info_basic &fi = fpb[i];
+        PathAttrCache &cache = dir->entries[entries[i].stringValue(KIO::UDSEntry::UDS_NAME)];
+        cache.st = {};
+        cache.st.st_mode = S_ISDIR(fi.unixprivs.permissions)
+            ? (S_IFDIR | (fi.unixprivs.permissions & 07777))
+            : (S_IFREG | (fi.unixprivs.permissions & 07777));
+        cache.st.st_uid = fi.unixprivs.uid;
+        cache.st.st_gid = fi.unixprivs.gid;
+        cache.st.st_size = static_cast<off_t>(fi.size);
+        cache.st.st_mtime = static_cast<time_t>(fi.modification_date);
+        cache.age.start();
+    }
+    m_pathAttrCount += dir->entries.size() - before;
+}
+
+bool AfpWorker::cachedPathAttrs(const ParsedUrl &pu, struct stat &st) const
+{
+    const auto dir = m_pathAttrs.constFind(parentKey(pu));
+    if (dir == m_pathAttrs.constEnd())
+        return false;
+    const auto it = dir->entries.constFind(pu.leafName().toString());
+    if (it == dir->entries.constEnd() || it->age.elapsed() > PATH_ATTR_TTL_MS)
+        return false;
+    st = it->st;
+    return true;
+}
+
+void AfpWorker::invalidatePathAttrs(const ParsedUrl &pu)
+{
+    if (m_pathAttrs.isEmpty())
+        return;
+
+    // Drop the path from its directory
+    bool mayBeDir = true;
+    if (auto dir = m_pathAttrs.find(parentKey(pu)); dir != m_pathAttrs.end()) {
+        if (auto it = dir->entries.find(pu.leafName().toString()); it != dir->entries.end()) {
+            mayBeDir = S_ISDIR(it->st.st_mode);
+            dir->entries.erase(it);
+            --m_pathAttrCount;
+        }
+    }
+
+    // and, for a directory, its own entries and those of its subdirectories
+    if (mayBeDir) {
+        const QString key = dirKey(pu, pu.path);
+        const QString prefix = key + QLatin1Char('/');
+        for (auto it = m_pathAttrs.begin(); it != m_pathAttrs.end();) {
+            if (it.key() == key || it.key().startsWith(prefix)) {
+                m_pathAttrCount -= it->entries.size();
+                it = m_pathAttrs.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    // The parent's modification time changes too; at the top level that
+    // is the volume root, see invalidateRootStat()
+    if (const auto &components = pu.components; components.size() > 1) {
+        const QStringView path(pu.path);
+        const qsizetype parentStart = components[components.size() - 2];
+        const QString grandparent = dirKey(pu, components.size() > 2 ? path.left(parentStart - 1)
+                                                                      : QStringView());
+        const QString parentName = path.mid(parentStart, components.last() - 1 - parentStart).toString();
+        if (auto dir = m_pathAttrs.find(grandparent); dir != m_pathAttrs.end() && dir->entries.remove(parentName))
+            --m_pathAttrCount;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// MIME types
+// ---------------------------------------------------------------------------
+
+QString AfpWorker::mimeTypeForName(const QString &name)
+{
+    // Names of one last extension share a type, unless a glob could match
+    // more of the name than that.  Those go to the database every time,
+    // as do names without an extension.
+    const qsizetype dot = name.lastIndexOf(QLatin1Char('.'));
+    const MimeGlobExceptions &exceptions = mimeGlobExceptions();
+    bool cacheable = dot > 0 && dot < name.size() - 1;
+    if (cacheable) {
+        if (const auto it = exceptions.prefixes.constFind(name.front().toLower());
+            it != exceptions.prefixes.constEnd()) {
+            cacheable = std::none_of(it->cbegin(), it->cend(), [&name](const QString &prefix) {
+                return name.startsWith(prefix, Qt::CaseInsensitive);
+            });
+        }
+        cacheable = cacheable
+            && std::none_of(exceptions.patterns.cbegin(), exceptions.patterns.cend(),
+                            [&name](const QRegularExpression &re) { return re.match(name).hasMatch(); });
+    }
+    if (!cacheable)
+        return mimeDatabase().mimeTypeForFile(name, QMimeDatabase::MatchExtension).name();
+
+    // Keyed by the extension as it is: some globs are case-sensitive,
+    // e.g. "*.C" and "*.c".  An empty type marks an extension that a
+    // multi-extension glob ends in.
+    const QString extension = name.mid(dot + 1);
+    if (const auto it = m_mimeCache.constFind(extension); it != m_mimeCache.constEnd()) {
+        if (!it->isEmpty())
+            return it.value();
+        return mimeDatabase().mimeTypeForFile(name, QMimeDatabase::MatchExtension).name();
+    }
+
+    if (m_mimeCache.size() >= MAX_MIME_CACHE_ENTRIES)
+        m_mimeCache.clear();
+
+    const QString mime = mimeDatabase().mimeTypeForFile(name, QMimeDatabase::MatchExtension).name();
+    m_mimeCache.insert(extension, exceptions.extensions.contains(extension.toLower()) ? QString() : mime);
+    return mime;
+}
+
 // ---------------------------------------------------------------------------
 // UDS entry helpers
 // ---------------------------------------------------------------------------
@@ -553,6 +1264,15 @@ KIO::UDSEntry AfpWorker::serverOrVolumeEntry(const QString &name) const
     return entry;
 }
 
+KIO::UDSEntry AfpWorker::volumeEntry(const QString &name) const
+{
+    KIO::UDSEntry entry;
+    entry.reserve(2);
+    entry.fastInsert(KIO::UDSEntry::UDS_NAME, name);
+    entry.fastInsert(KIO::UDSEntry::UDS_FILE_TYPE, S_IFDIR);
+    return entry;
+}
+
 KIO::UDSEntry AfpWorker::volumeSummaryToUDS(const struct afp_volume_summary &vol) const
 {
     KIO::UDSEntry entry;
@@ -573,6 +1293,115 @@ KIO::UDSEntry AfpWorker::volumeSummaryToUDS(const struct afp_volume_summary &vol
     return entry;
 }
 
+KIO::UDSEntry AfpWorker::fileInfoToUDS(const struct afp_file_info_basic &fi)
+{
+    KIO::UDSEntry entry;
+    entry.reserve(9);
+
+    // Emit everything the enumeration reply carries, so details views and
+    // sorting by creation time don't need a stat() per item.
+    const QString name = m_pathCodec.decodeName(fi.name);
+    entry.fastInsert(KIO::UDSEntry::UDS_NAME, name);
+    entry.fastInsert(KIO::UDSEntry::UDS_SIZE,
+                     static_cast<long long>(fi.size));
+    entry.fastInsert(KIO::UDSEntry::UDS_MODIFICATION_TIME,
+                     static_cast<long long>(fi.modification_date));
+    if (fi.creation_date != 0)
+        entry.fastInsert(KIO::UDSEntry::UDS_CREATION_TIME,
+                         static_cast<long long>(fi.creation_date));
+
+    if (S_ISDIR(fi.unixprivs.permissions)) {
+        entry.fastInsert(KIO::UDSEntry::UDS_FILE_TYPE, S_IFDIR);
+        entry.fastInsert(KIO::UDSEntry::UDS_MIME_TYPE,
+                         QStringLiteral("inode/directory"));
+    } else {
+        entry.fastInsert(KIO::UDSEntry::UDS_FILE_TYPE, S_IFREG);
+        // Leave unknown extensions to the client's content sniffing
+        if (const QString mime = mimeTypeForName(name);
+            mime != QLatin1String("application/octet-stream"))
+            entry.fastInsert(KIO::UDSEntry::UDS_MIME_TYPE, mime);
+    }
+
+    entry.fastInsert(KIO::UDSEntry::UDS_ACCESS,
+                     fi.unixprivs.permissions & 07777);
+
+    struct passwd *pw = getpwuid(fi.unixprivs.uid);
+    entry.fastInsert(KIO::UDSEntry::UDS_USER,
+                     pw ? QString::fromLocal8Bit(pw->pw_name)
+                        : QString::number(fi.unixprivs.uid));
+    struct group *gr = getgrgid(fi.unixprivs.gid);
+    entry.fastInsert(KIO::UDSEntry::UDS_GROUP,
+                     gr ? QString::fromLocal8Bit(gr->gr_name)
+                        : QString::number(fi.unixprivs.gid));
+
+    return entry;
+}
+
+// ---------------------------------------------------------------------------
+// Job I/O
+// ---------------------------------------------------------------------------
+
+void AfpWorker::emitStat(const KIO::UDSEntry &entry)
+{
+    statEntry(entry);
+}
+
+void AfpWorker::emitEntry(const KIO::UDSEntry &entry)
+{
+    listEntry(entry);
+}
+
+void AfpWorker::emitEntries(const KIO::UDSEntryList &entries)
+{
+    listEntries(entries);
+}
+
+void AfpWorker::emitData(const QByteArray &data)
+{
+    this->data(data);
+}
+
+int AfpWorker::fetchData(QByteArray &buffer)
+{
+    dataReq();
+    return readData(buffer);
+}
+
+void AfpWorker::emitProgress(KIO::filesize_t processed, unsigned long bytesPerSecond)
+{
+    processedSize(processed);
+    if (bytesPerSecond > 0)
+        speed(bytesPerSecond);
+}
+
+QString AfpWorker::jobMetaData(const QString &key) const
+{
+    return metaData(key);
+}
+
+bool AfpWorker::jobKilled() const
+{
+    return wasKilled();
+}
+
+int AfpWorker::settingValue(const QString &key, int defaultValue) const
+{
+    return configValue(key, defaultValue);
+}
+
+// ---------------------------------------------------------------------------
+// Transfer accounting
+// ---------------------------------------------------------------------------
+
+void AfpWorker::finishTransfer(KioOp op, const TransferMeter &meter)
+{
+    const qint64 nsecs = meter.nsecsElapsed();
+    emitProgress(static_cast<KIO::filesize_t>(meter.bytes()), meter.rate());
+    const double rate = AfpStats::instance().recordTransfer(op, meter.bytes(), nsecs);
+    qCDebug(logAfp) << "kio-afp:" << kioOpName(op) << "summary bytes=" << meter.bytes()
+                    << "ms=" << nsecs / 1000000 << "MB/s=" << rate / (1024.0 * 1024.0);
+}
+
 // ---------------------------------------------------------------------------
 // Error mapping
 // ---------------------------------------------------------------------------
@@ -645,6 +1474,7 @@ KIO::WorkerResult AfpWorker::mapAfpConnectError(int ret, const QString &server)
 
 KIO::WorkerResult AfpWorker::stat(const QUrl &url)
 {
+    const OperationTimer opTimer(KioOp::Stat);
     qCDebug(logAfp) << "AfpWorker::stat()" << url;
 
     ParsedUrl pu = parseAfpUrl(url);
@@ -653,68 +1483,87 @@ KIO::WorkerResult AfpWorker::stat(const QUrl &url)
     // Skip connecting: listDir() will establish the connection when it
     // actually needs to talk to the daemon, reducing connect call volume.
     if (!pu.hasVolume) {
-        statEntry(serverOrVolumeEntry(QString()));
+        emitStat(serverOrVolumeEntry(QString()));
         return KIO::WorkerResult::pass();
     }
 
     // Volume root: afp://server/volume
-    // Attach and do a real stat so Dolphin sees actual permissions
-    // (needed for drag-and-drop writability checks on the listing view).
-    // Fall back to a synthetic entry if attachment fails.
+    // File dialogs stat every volume they pass by.  Answer from a recent
+    // root stat, or without attaching for a volume we know exists, and only
+    // attach when neither is available.  Without a stat the permissions
+    // are unknown and left out rather than guessed; Dolphin's writability
+    // checks use the "." entry of the listing, which has the real ones.
     if (!pu.hasPath) {
+        struct stat st {};
+        if (cachedRootStat(pu, st)) {
+            emitStat(statToUDS(st, pu.volume));
+            return KIO::WorkerResult::pass();
+        }
+
+        const bool attached = m_serverId && m_cachedServer == pu.server
+            && m_attachedVolumes.contains(pu.volume);
+        if (!attached && volumeIsListed(pu)) {
+            qCDebug(logAfp) << "kio-afp: volume-root stat from volume list";
+            emitStat(volumeEntry(pu.volume));
+            return KIO::WorkerResult::pass();
+        }
+
         if (auto r = ensureAttached(pu); r.success()) {
-            struct stat st {};
-            int ret = afp_sl_stat(&m_volumeId, "/", &pu.afpUrl, &st);
+            int ret = afpCall(AfpCall::Stat, afp_sl_stat, &m_volumeId, "/", &pu.afpUrl, &st);
             if (ret != AFP_SERVER_RESULT_OKAY && isRecoverableSessionError(ret)) {
                 invalidateSessionState("volume-root stat failed");
                 if (auto rr = ensureAttached(pu); rr.success())
-                    ret = afp_sl_stat(&m_volumeId, "/", &pu.afpUrl, &st);
+                    ret = afpCall(AfpCall::Stat, afp_sl_stat, &m_volumeId, "/", &pu.afpUrl, &st);
             }
             if (ret == AFP_SERVER_RESULT_OKAY) {
-                statEntry(statToUDS(st, pu.volume));
+                cacheRootStat(pu, st);
+                emitStat(statToUDS(st, pu.volume));
                 return KIO::WorkerResult::pass();
             }
         }
-        statEntry(serverOrVolumeEntry(pu.volume));
+        emitStat(volumeEntry(pu.volume));
         return KIO::WorkerResult::pass();
     }
 
     // File/dir within volume
-    if (auto r = ensureAttached(pu); !r.success())
-        return r;
-
     struct stat st {};
-    int ret = afp_sl_stat(&m_volumeId, pu.afpUrl.path, &pu.afpUrl, &st);
-    if (ret != AFP_SERVER_RESULT_OKAY && isRecoverableSessionError(ret)) {
-        invalidateSessionState("stat failed");
-        if (auto rr = ensureAttached(pu); !rr.success())
-            return rr;
-        ret = afp_sl_stat(&m_volumeId, pu.afpUrl.path, &pu.afpUrl, &st);
+    if (cachedPathAttrs(pu, st)) {
+        qCDebug(logAfp) << "kio-afp: stat from cached attributes";
+    } else {
+        if (auto r = ensureAttached(pu); !r.success())
+            return r;
+
+        int ret = afpCall(AfpCall::Stat, afp_sl_stat, &m_volumeId, pu.afpUrl.path, &pu.afpUrl, &st);
+        if (ret != AFP_SERVER_RESULT_OKAY && isRecoverableSessionError(ret)) {
+            invalidateSessionState("stat failed");
+            if (auto rr = ensureAttached(pu); !rr.success())
+                return rr;
+            ret = afpCall(AfpCall::Stat, afp_sl_stat, &m_volumeId, pu.afpUrl.path, &pu.afpUrl, &st);
+        }
+        if (ret != AFP_SERVER_RESULT_OKAY)
+            return mapAfpError(ret, pu.path);
+        cachePathAttrs(pu, st);
     }
-    if (ret != AFP_SERVER_RESULT_OKAY)
-        return mapAfpError(ret, pu.path);
 
     // Determine the file name (last component)
-    const QStringList parts = pu.path.split(QLatin1Char('/'), Qt::SkipEmptyParts);
-    const QString name = parts.isEmpty() ? pu.volume : parts.last();
+    const QString name = pu.leafName().toString();
 
     KIO::UDSEntry entry = statToUDS(st, name);
 
     // Add MIME type
     if (S_ISREG(st.st_mode)) {
-        QMimeDatabase db;
-        entry.fastInsert(KIO::UDSEntry::UDS_MIME_TYPE,
-                         db.mimeTypeForFile(name, QMimeDatabase::MatchExtension).name());
+        entry.fastInsert(KIO::UDSEntry::UDS_MIME_TYPE, mimeTypeForName(name));
     } else if (S_ISDIR(st.st_mode)) {
         entry.fastInsert(KIO::UDSEntry::UDS_MIME_TYPE, QStringLiteral("inode/directory"));
     }
 
-    statEntry(entry);
+    emitStat(entry);
     return KIO::WorkerResult::pass();
 }
 
 KIO::WorkerResult AfpWorker::listDir(const QUrl &url)
 {
+    const OperationTimer opTimer(KioOp::ListDir);
     qCDebug(logAfp) << "AfpWorker::listDir()" << url;
 
     ParsedUrl pu = parseAfpUrl(url);
@@ -724,43 +1573,70 @@ KIO::WorkerResult AfpWorker::listDir(const QUrl &url)
         if (auto r = ensureConnected(pu); !r.success())
             return r;
 
-        constexpr unsigned int MAX_VOLS = 64;
-        struct afp_volume_summary vols[MAX_VOLS];
-        unsigned int numVols = 0;
+        const auto cached = m_volumeLists.constFind(pu.server);
+        const qint64 age = (cached != m_volumeLists.constEnd() && cached->age.isValid())
+            ? cached->age.elapsed()
+            : -1;
 
-        int ret = afp_sl_getvols(&pu.afpUrl, 0, MAX_VOLS, &numVols, vols);
-        qCDebug(logAfp) << "kio-afp: getvols returned" << ret
-                        << "numVols=" << numVols;
-        if (ret != AFP_SERVER_RESULT_OKAY && isRecoverableSessionError(ret)) {
-            invalidateSessionState("getvols failed");
-            if (auto rr = ensureConnected(pu); !rr.success())
-                return rr;
-            numVols = 0;
-            ret = afp_sl_getvols(&pu.afpUrl, 0, MAX_VOLS, &numVols, vols);
-            qWarning() << "kio-afp: getvols retry after reconnect returned"
-                       << ret << "numVols=" << numVols;
-        }
+        QList<struct afp_volume_summary> vols;
+        bool refreshInBackground = false;
 
-        // On a fresh daemon the volume list may not be ready yet.
-        // Retry once after a short delay if we got zero volumes.
-        if (ret == AFP_SERVER_RESULT_OKAY && numVols == 0) {
-            qCDebug(logAfp) << "kio-afp: empty volume list, retrying after delay";
-            QThread::msleep(500);
-            numVols = 0;
-            ret = afp_sl_getvols(&pu.afpUrl, 0, MAX_VOLS, &numVols, vols);
-            qCDebug(logAfp) << "kio-afp: getvols retry returned" << ret
-                            << "numVols=" << numVols;
-        }
+        if (age >= 0 && age <= VOLUME_LIST_MAX_AGE_MS) {
+            qCDebug(logAfp) << "kio-afp: using cached volume list, age" << age << "ms";
+            vols = cached->volumes;
+            refreshInBackground = age > VOLUME_LIST_TTL_MS;
+        } else {
+            int ret = getAllVolumes(&pu.afpUrl, vols);
+            if (ret != AFP_SERVER_RESULT_OKAY && isRecoverableSessionError(ret)) {
+                invalidateSessionState("getvols failed");
+                if (auto rr = ensureConnected(pu); !rr.success())
+                    return rr;
+                ret = getAllVolumes(&pu.afpUrl, vols);
+                qWarning() << "kio-afp: getvols retry after reconnect returned"
+                           << ret << "numVols=" << vols.size();
+            }
 
-        if (ret != AFP_SERVER_RESULT_OKAY)
-            return mapAfpError(ret, pu.server);
+            // On a fresh daemon the volume list may not be ready yet.
+            // Poll with a short exponential backoff until it shows up or the
+            // deadline passes, so the common case returns as soon as it's ready.
+            if (ret == AFP_SERVER_RESULT_OKAY && vols.isEmpty()) {
+                constexpr qint64 READY_DEADLINE_MS = 2000;
+                constexpr qint64 MAX_POLL_DELAY_MS = 250;
+                qint64 delay = 10;
+                QElapsedTimer waited;
+                waited.start();
+
+                qCDebug(logAfp) << "kio-afp: empty volume list, waiting for daemon";
+                while (ret == AFP_SERVER_RESULT_OKAY && vols.isEmpty() && !jobKilled()) {
+                    const qint64 remaining = READY_DEADLINE_MS - waited.elapsed();
+                    if (remaining <= 0)
+                        break;
+                    QThread::msleep(static_cast<unsigned long>(std::min(delay, remaining)));
+                    delay = std::min(delay * 2, MAX_POLL_DELAY_MS);
+                    ret = getAllVolumes(&pu.afpUrl, vols);
+                }
+                qCDebug(logAfp) << "kio-afp: getvols after" << waited.elapsed()
+                                << "ms returned" << ret << "numVols=" << vols.size();
+            }
+
+            if (ret != AFP_SERVER_RESULT_OKAY)
+                return mapAfpError(ret, pu.server);
+
+            // Don't cache an empty list; the daemon may just be slow to fill it
+            if (!vols.isEmpty()) {
+                VolumeListCache &cache = m_volumeLists[pu.server];
+                cache.volumes = vols;
+                cache.age.start();
+            }
+        }
 
         KIO::UDSEntryList entries;
-        entries.reserve(static_cast<int>(numVols));
-        for (unsigned int i = 0; i < numVols; ++i)
-            entries << volumeSummaryToUDS(vols[i]);
+        entries.reserve(vols.size());
+        for (const struct afp_volume_summary &vol : vols)
+            entries << volumeSummaryToUDS(vol);
+        emitEntries(entries);
 
-        listEntries(entries);
+        startBackgroundRefresh(pu, refreshInBackground);
         return KIO::WorkerResult::pass();
     }
 
@@ -771,36 +1647,154 @@ KIO::WorkerResult AfpWorker::listDir(const QUrl &url)
     // Path for readdir: "/" for volume root, or the absolute subpath
     const char *dirPath = pu.hasPath ? pu.afpUrl.path : "/";
 
-    // Stat the directory itself and emit a "." entry so KDirLister has
-    // the root item immediately, even if a separate stat job is still
-    // queued behind this listDir in another worker process.  Without
-    // this, Dolphin's drag-and-drop writability check on the view
-    // background can fail because rootItem() is null.
-    {
+    // Emit a "." entry so KDirLister has the root item early, even if a
+    // separate stat job is still queued behind this listDir in another
+    // worker process.  Without it, Dolphin's drag-and-drop writability
+    // check on the view background can fail because rootItem() is null.
+    // Attributes remembered from the parent's listing are used as they
+    // are; otherwise the stat waits until the first entries are out, so
+    // big folders start painting one round trip sooner.
+    const auto emitDotEntry = [this](const struct stat &st) {
+        KIO::UDSEntry dotEntry = statToUDS(st, QStringLiteral("."));
+        if (S_ISDIR(st.st_mode))
+            dotEntry.fastInsert(KIO::UDSEntry::UDS_MIME_TYPE,
+                                QStringLiteral("inode/directory"));
+        emitEntry(dotEntry);
+    };
+    const auto statDotEntry = [this, &pu, dirPath, &emitDotEntry] {
         struct stat dirSt {};
-        if (int dirRet = afp_sl_stat(&m_volumeId, dirPath, &pu.afpUrl, &dirSt);
+        if (int dirRet = afpCall(AfpCall::Stat, afp_sl_stat, &m_volumeId, dirPath, &pu.afpUrl, &dirSt);
             dirRet == AFP_SERVER_RESULT_OKAY) {
-            KIO::UDSEntry dotEntry = statToUDS(dirSt, QStringLiteral("."));
-            if (S_ISDIR(dirSt.st_mode))
-                dotEntry.fastInsert(KIO::UDSEntry::UDS_MIME_TYPE,
-                                    QStringLiteral("inode/directory"));
-            listEntry(dotEntry);
+            if (pu.hasPath)
+                cachePathAttrs(pu, dirSt);
+            else
+                cacheRootStat(pu, dirSt);
+            emitDotEntry(dirSt);
         }
+    };
+
+    bool dotPending = true;
+    if (struct stat dirSt {}; pu.hasPath ? cachedPathAttrs(pu, dirSt) : cachedRootStat(pu, dirSt)) {
+        emitDotEntry(dirSt);
+        dotPending = false;
+    }
+
+    // A client that sets the "listRecursive" metadata gets every descendant
+    // streamed back in one job, named by its path relative to the listed
+    // directory.  This is a kio-afp extension: KIO's own copy, delete and
+    // size jobs don't set it and keep walking the tree one listDir at a time.
+    if (jobMetaData(QStringLiteral("listRecursive")) == QLatin1String("true")) {
+        if (dotPending)
+            statDotEntry();
+        return listRecursive(pu);
     }
 
-    constexpr int BATCH = 64;
+    // A small first batch gets entries on screen quickly; later batches
+    // grow to save round trips on big folders
+    constexpr int FIRST_BATCH = 16;
+    constexpr int MAX_BATCH = 256;
+    const QString key = dirKey(pu, pu.path);
+    qsizetype attrsLeft = LISTING_ATTR_ENTRIES;
+    return readDirectory(pu, dirPath, FIRST_BATCH, MAX_BATCH, pu.hasPath ? pu.path : pu.volume,
+                         [this, &key, &attrsLeft, &dotPending, &statDotEntry](const struct afp_file_info_basic *fpb,
+                                                                              unsigned int numFiles) {
+                             KIO::UDSEntryList entries;
+                             entries.reserve(static_cast<int>(numFiles));
+                             for (unsigned int i = 0; i < numFiles; ++i)
+                                 entries << fileInfoToUDS(fpb[i]);
+                             // Past the first entries of a big folder the cache
+                             // would only churn
+                             if (attrsLeft > 0) {
+                                 const qsizetype n = std::min<qsizetype>(attrsLeft, entries.size());
+                                 cacheListedAttrs(key, fpb, entries, n);
+                                 attrsLeft -= n;
+                             }
+                             emitEntries(entries);
+                             if (dotPending) {
+                                 dotPending = false;
+                                 statDotEntry();
+                             }
+                         });
+}
+
+KIO::WorkerResult AfpWorker::listRecursive(ParsedUrl &pu)
+{
+    // Breadth-first walk over the tree below pu, entirely inside this
+    // worker: no job round trip and no stat of "." per directory.
+    constexpr int RECURSIVE_BATCH = 256;
+    const QByteArray base = pu.hasPath ? QByteArray(pu.afpUrl.path) : QByteArray();
+
+    std::deque<QString> pending;
+    pending.emplace_back();
+
+    while (!pending.empty()) {
+        if (jobKilled())
+            return KIO::WorkerResult::fail(KIO::ERR_USER_CANCELED, pu.path);
+
+        const QString rel = std::move(pending.front());
+        pending.pop_front();
+
+        const QByteArray dirPath = rel.isEmpty()
+            ? (base.isEmpty() ? QByteArray("/") : base)
+            : base + '/' + m_pathCodec.encodePath(rel);
+        const QString prefix = rel.isEmpty() ? QString() : rel + QLatin1Char('/');
+        const QString top = pu.hasPath ? pu.path : pu.volume;
+        const QString errorPath = rel.isEmpty() ? top : top + QLatin1Char('/') + rel;
+
+        auto r = readDirectory(
+            pu, dirPath.constData(), RECURSIVE_BATCH, RECURSIVE_BATCH, errorPath,
+            [&](const struct afp_file_info_basic *fpb, unsigned int numFiles) {
+                KIO::UDSEntryList entries;
+                entries.reserve(static_cast<int>(numFiles));
+                for (unsigned int i = 0; i < numFiles; ++i) {
+                    KIO::UDSEntry entry = fileInfoToUDS(fpb[i]);
+                    const QString relName = prefix + m_pathCodec.decodeName(fpb[i].name);
+                    entry.replace(KIO::UDSEntry::UDS_NAME, relName);
+                    if (S_ISDIR(fpb[i].unixprivs.permissions))
+                        pending.push_back(relName);
+                    entries << entry;
+                }
+                emitEntries(entries);
+            });
+
+        if (!r.success()) {
+            // The top-level directory has to be readable; unreadable
+            // subdirectories are skipped, like a client-side walk would.
+            if (rel.isEmpty())
+                return r;
+            qCDebug(logAfp) << "kio-afp: listRecursive skipping" << rel << r.errorString();
+        }
+    }
+    return KIO::WorkerResult::pass();
+}
+
+KIO::WorkerResult AfpWorker::readDirectory(ParsedUrl &pu, const char *dirPath, int firstBatch,
+                                           int maxBatch, const QString &errorPath,
+                                           const DirBatchSink &sink)
+{
     int start = 0;
+    int batch = firstBatch;
     bool done = false;
+    std::vector<struct afp_file_info_basic> entries;
 
     while (!done) {
         struct afp_file_info_basic *fpb = nullptr;
         unsigned int numFiles = 0;
         int eod = 0;
 
+        // The entries live in libafpsl's reply buffer, which the warm-up
+        // thread's next call overwrites: copy them before letting it in
+        const auto copyEntries = [&entries, &fpb, &numFiles](int ret) {
+            if (ret == AFP_SERVER_RESULT_OKAY && fpb)
+                entries.assign(fpb, fpb + numFiles);
+            else
+                entries.clear();
+        };
+
         qCDebug(logAfp) << "kio-afp: readdir path=" << dirPath
                         << "start=" << start << "vid=" << m_volumeId;
-        int ret = afp_sl_readdir(&m_volumeId, dirPath, &pu.afpUrl,
-                                 start, BATCH, &numFiles, &fpb, &eod);
+        int ret = afpCallConsume(AfpCall::Readdir, copyEntries, afp_sl_readdir, &m_volumeId,
+                                 dirPath, &pu.afpUrl, start, batch, &numFiles, &fpb, &eod);
         qCDebug(logAfp) << "kio-afp: readdir returned" << ret
                         << "numFiles=" << numFiles << "eod=" << eod;
         if (ret != AFP_SERVER_RESULT_OKAY && isRecoverableSessionError(ret)) {
@@ -812,54 +1806,18 @@ KIO::WorkerResult AfpWorker::listDir(const QUrl &url)
             numFiles = 0;
             fpb = nullptr;
             eod = 0;
-            ret = afp_sl_readdir(&m_volumeId, dirPath, &pu.afpUrl,
-                                 start, BATCH, &numFiles, &fpb, &eod);
+            ret = afpCallConsume(AfpCall::Readdir, copyEntries, afp_sl_readdir, &m_volumeId,
+                                 dirPath, &pu.afpUrl, start, batch, &numFiles, &fpb, &eod);
             qCDebug(logAfp) << "kio-afp: readdir retry returned" << ret
                             << "numFiles=" << numFiles << "eod=" << eod;
         }
-        if (ret != AFP_SERVER_RESULT_OKAY) {
-            return mapAfpError(ret, pu.hasPath ? pu.path : pu.volume);
-        }
-
-        KIO::UDSEntryList entries;
-        entries.reserve(static_cast<int>(numFiles));
-        for (unsigned int i = 0; i < numFiles; ++i) {
-            const struct afp_file_info_basic &fi = fpb[i];
-            KIO::UDSEntry entry;
-            entry.reserve(7);
-
-            entry.fastInsert(KIO::UDSEntry::UDS_NAME,
-                             QString::fromUtf8(fi.name));
-            entry.fastInsert(KIO::UDSEntry::UDS_SIZE,
-                             static_cast<long long>(fi.size));
-            entry.fastInsert(KIO::UDSEntry::UDS_MODIFICATION_TIME,
-                             static_cast<long long>(fi.modification_date));
-
-            if (S_ISDIR(fi.unixprivs.permissions)) {
-                entry.fastInsert(KIO::UDSEntry::UDS_FILE_TYPE, S_IFDIR);
-                entry.fastInsert(KIO::UDSEntry::UDS_MIME_TYPE,
-                                 QStringLiteral("inode/directory"));
-            } else {
-                entry.fastInsert(KIO::UDSEntry::UDS_FILE_TYPE, S_IFREG);
-            }
-
-            entry.fastInsert(KIO::UDSEntry::UDS_ACCESS,
-                             fi.unixprivs.permissions & 07777);
-
-            struct passwd *pw = getpwuid(fi.unixprivs.uid);
-            entry.fastInsert(KIO::UDSEntry::UDS_USER,
-                             pw ? QString::fromLocal8Bit(pw->pw_name)
-                                : QString::number(fi.unixprivs.uid));
-            struct group *gr = getgrgid(fi.unixprivs.gid);
-            entry.fastInsert(KIO::UDSEntry::UDS_GROUP,
-                             gr ? QString::fromLocal8Bit(gr->gr_name)
-                                : QString::number(fi.unixprivs.gid));
+        if (ret != AFP_SERVER_RESULT_OKAY)
+            return mapAfpError(ret, errorPath);
 
-            entries << entry;
-        }
-        listEntries(entries);
+        sink(entries.data(), static_cast<unsigned int>(entries.size()));
 
         start += static_cast<int>(numFiles);
+        batch = std::min(batch * 2, maxBatch);
         if (eod || numFiles == 0)
             done = true;
     }
@@ -869,6 +1827,7 @@ KIO::WorkerResult AfpWorker::listDir(const QUrl &url)
 
 KIO::WorkerResult AfpWorker::get(const QUrl &url)
 {
+    OperationTimer opTimer(KioOp::Get);
     qCDebug(logAfp) << "kio-afp: get()" << url;
 
     ParsedUrl pu = parseAfpUrl(url);
@@ -879,18 +1838,21 @@ KIO::WorkerResult AfpWorker::get(const QUrl &url)
     if (auto r = ensureAttached(pu); !r.success())
         return r;
 
-    // Stat the file to get size
+    // Stat the file to get size, unless a recent listing already told us
     struct stat st {};
-    int ret = afp_sl_stat(&m_volumeId, pu.afpUrl.path, &pu.afpUrl, &st);
-    if (ret != AFP_SERVER_RESULT_OKAY && isRecoverableSessionError(ret)) {
-        invalidateSessionState("get stat failed");
-        if (auto rr = ensureAttached(pu); !rr.success())
-            return rr;
-        ret = afp_sl_stat(&m_volumeId, pu.afpUrl.path, &pu.afpUrl, &st);
-    }
-    if (ret != AFP_SERVER_RESULT_OKAY) {
-        qCDebug(logAfp) << "kio-afp: get stat failed ret=" << ret;
-        return mapAfpError(ret, pu.path);
+    int ret = AFP_SERVER_RESULT_OKAY;
+    if (!cachedPathAttrs(pu, st)) {
+        ret = afpCall(AfpCall::Stat, afp_sl_stat, &m_volumeId, pu.afpUrl.path, &pu.afpUrl, &st);
+        if (ret != AFP_SERVER_RESULT_OKAY && isRecoverableSessionError(ret)) {
+            invalidateSessionState("get stat failed");
+            if (auto rr = ensureAttached(pu); !rr.success())
+                return rr;
+            ret = afpCall(AfpCall::Stat, afp_sl_stat, &m_volumeId, pu.afpUrl.path, &pu.afpUrl, &st);
+        }
+        if (ret != AFP_SERVER_RESULT_OKAY) {
+            qCDebug(logAfp) << "kio-afp: get stat failed ret=" << ret;
+            return mapAfpError(ret, pu.path);
+        }
     }
 
     if (S_ISDIR(st.st_mode))
@@ -900,21 +1862,16 @@ KIO::WorkerResult AfpWorker::get(const QUrl &url)
     totalSize(static_cast<KIO::filesize_t>(st.st_size));
 
     // Set MIME type
-    {
-        QMimeDatabase db;
-        const QStringList parts = pu.path.split(QLatin1Char('/'), Qt::SkipEmptyParts);
-        const QString name = parts.isEmpty() ? pu.path : parts.last();
-        mimeType(db.mimeTypeForFile(name, QMimeDatabase::MatchExtension).name());
-    }
+    mimeType(mimeTypeForName(pu.leafName().toString()));
 
     // Open
     unsigned int fileId = 0;
-    ret = afp_sl_open(&m_volumeId, pu.afpUrl.path, &pu.afpUrl, &fileId, O_RDONLY);
+    ret = afpCall(AfpCall::Open, afp_sl_open, &m_volumeId, pu.afpUrl.path, &pu.afpUrl, &fileId, O_RDONLY);
     if (ret != AFP_SERVER_RESULT_OKAY && isRecoverableSessionError(ret)) {
         invalidateSessionState("get open failed");
         if (auto rr = ensureAttached(pu); !rr.success())
             return rr;
-        ret = afp_sl_open(&m_volumeId, pu.afpUrl.path, &pu.afpUrl, &fileId, O_RDONLY);
+        ret = afpCall(AfpCall::Open, afp_sl_open, &m_volumeId, pu.afpUrl.path, &pu.afpUrl, &fileId, O_RDONLY);
     }
     if (ret != AFP_SERVER_RESULT_OKAY) {
         qCDebug(logAfp) << "kio-afp: get open failed ret=" << ret;
@@ -926,36 +1883,42 @@ KIO::WorkerResult AfpWorker::get(const QUrl &url)
     unsigned long long offset = 0;
     char buf[READ_CHUNK];
     bool eof = false;
+    TransferMeter meter;
 
     while (!eof) {
         unsigned int received = 0;
         unsigned int eofFlag = 0;
-        ret = afp_sl_read(&m_volumeId, fileId, 0 /* data fork */,
-                          offset, READ_CHUNK, &received, &eofFlag, buf);
+        ret = afpTransfer(AfpCall::Read, &received, afp_sl_read, &m_volumeId, fileId,
+                          0 /* data fork */, offset, READ_CHUNK, &received, &eofFlag, buf);
         if (ret != AFP_SERVER_RESULT_OKAY) {
             qCDebug(logAfp) << "kio-afp: get read failed at offset" << offset
                             << "ret=" << ret;
-            afp_sl_close(&m_volumeId, fileId);
+            afpCall(AfpCall::Close, afp_sl_close, &m_volumeId, fileId);
             return mapAfpError(ret, pu.path);
         }
 
         if (received > 0) {
-            data(QByteArray(buf, static_cast<int>(received)));
+            emitData(QByteArray(buf, static_cast<int>(received)));
             offset += received;
+            if (meter.add(received))
+                emitProgress(offset, meter.rate());
         }
 
         if (eofFlag || received == 0)
             eof = true;
     }
 
-    afp_sl_close(&m_volumeId, fileId);
+    afpCall(AfpCall::Close, afp_sl_close, &m_volumeId, fileId);
     qCDebug(logAfp) << "kio-afp: get complete, read" << offset << "bytes";
-    data(QByteArray()); // signal end of data
+    opTimer.setBytes(static_cast<qint64>(offset));
+    finishTransfer(KioOp::Get, meter);
+    emitData(QByteArray()); // signal end of data
     return KIO::WorkerResult::pass();
 }
 
 KIO::WorkerResult AfpWorker::put(const QUrl &url, int permissions, KIO::JobFlags flags)
 {
+    OperationTimer opTimer(KioOp::Put);
     qCDebug(logAfp) << "kio-afp: put()" << url << "permissions=" << permissions
                     << "flags=" << static_cast<int>(flags);
 
@@ -966,15 +1929,16 @@ KIO::WorkerResult AfpWorker::put(const QUrl &url, int permissions, KIO::JobFlags
 
     if (auto r = ensureAttached(pu); !r.success())
         return r;
+    invalidatePathAttrs(pu);
 
     // Check if file exists
     struct stat st {};
-    int ret = afp_sl_stat(&m_volumeId, pu.afpUrl.path, &pu.afpUrl, &st);
+    int ret = afpCall(AfpCall::Stat, afp_sl_stat, &m_volumeId, pu.afpUrl.path, &pu.afpUrl, &st);
     if (ret != AFP_SERVER_RESULT_OKAY && isRecoverableSessionError(ret)) {
         invalidateSessionState("put stat failed");
         if (auto rr = ensureAttached(pu); !rr.success())
             return rr;
-        ret = afp_sl_stat(&m_volumeId, pu.afpUrl.path, &pu.afpUrl, &st);
+        ret = afpCall(AfpCall::Stat, afp_sl_stat, &m_volumeId, pu.afpUrl.path, &pu.afpUrl, &st);
     }
     bool exists = (ret == AFP_SERVER_RESULT_OKAY);
     qCDebug(logAfp) << "kio-afp: put stat ret=" << ret << "exists=" << exists;
@@ -985,13 +1949,13 @@ KIO::WorkerResult AfpWorker::put(const QUrl &url, int permissions, KIO::JobFlags
     // Create file if it doesn't exist
     if (!exists) {
         mode_t mode = (permissions == -1) ? 0644 : static_cast<mode_t>(permissions);
-        ret = afp_sl_creat(&m_volumeId, pu.afpUrl.path, &pu.afpUrl, mode);
+        ret = afpCall(AfpCall::Creat, afp_sl_creat, &m_volumeId, pu.afpUrl.path, &pu.afpUrl, mode);
         qCDebug(logAfp) << "kio-afp: put creat ret=" << ret;
         if (ret != AFP_SERVER_RESULT_OKAY && isRecoverableSessionError(ret)) {
             invalidateSessionState("put creat failed");
             if (auto rr = ensureAttached(pu); !rr.success())
                 return rr;
-            ret = afp_sl_creat(&m_volumeId, pu.afpUrl.path, &pu.afpUrl, mode);
+            ret = afpCall(AfpCall::Creat, afp_sl_creat, &m_volumeId, pu.afpUrl.path, &pu.afpUrl, mode);
             qCDebug(logAfp) << "kio-afp: put creat retry ret=" << ret;
         }
         if (ret != AFP_SERVER_RESULT_OKAY)
@@ -1000,13 +1964,13 @@ KIO::WorkerResult AfpWorker::put(const QUrl &url, int permissions, KIO::JobFlags
 
     // Truncate before open when overwriting (matches reference implementation)
     if (exists && (flags & KIO::Overwrite)) {
-        ret = afp_sl_truncate(&m_volumeId, pu.afpUrl.path, &pu.afpUrl, 0);
+        ret = afpCall(AfpCall::Truncate, afp_sl_truncate, &m_volumeId, pu.afpUrl.path, &pu.afpUrl, 0);
         qCDebug(logAfp) << "kio-afp: put truncate ret=" << ret;
         if (ret != AFP_SERVER_RESULT_OKAY && isRecoverableSessionError(ret)) {
             invalidateSessionState("put truncate failed");
             if (auto rr = ensureAttached(pu); !rr.success())
                 return rr;
-            ret = afp_sl_truncate(&m_volumeId, pu.afpUrl.path, &pu.afpUrl, 0);
+            ret = afpCall(AfpCall::Truncate, afp_sl_truncate, &m_volumeId, pu.afpUrl.path, &pu.afpUrl, 0);
             qCDebug(logAfp) << "kio-afp: put truncate retry ret=" << ret;
         }
         if (ret != AFP_SERVER_RESULT_OKAY)
@@ -1015,13 +1979,13 @@ KIO::WorkerResult AfpWorker::put(const QUrl &url, int permissions, KIO::JobFlags
 
     // Open for read/write (AFP servers may not handle write-only correctly)
     unsigned int fileId = 0;
-    ret = afp_sl_open(&m_volumeId, pu.afpUrl.path, &pu.afpUrl, &fileId, O_RDWR);
+    ret = afpCall(AfpCall::Open, afp_sl_open, &m_volumeId, pu.afpUrl.path, &pu.afpUrl, &fileId, O_RDWR);
     qCDebug(logAfp) << "kio-afp: put open ret=" << ret << "fileId=" << fileId;
     if (ret != AFP_SERVER_RESULT_OKAY && isRecoverableSessionError(ret)) {
         invalidateSessionState("put open failed");
         if (auto rr = ensureAttached(pu); !rr.success())
             return rr;
-        ret = afp_sl_open(&m_volumeId, pu.afpUrl.path, &pu.afpUrl, &fileId, O_RDWR);
+        ret = afpCall(AfpCall::Open, afp_sl_open, &m_volumeId, pu.afpUrl.path, &pu.afpUrl, &fileId, O_RDWR);
         qCDebug(logAfp) << "kio-afp: put open retry ret=" << ret << "fileId=" << fileId;
     }
     if (ret != AFP_SERVER_RESULT_OKAY)
@@ -1030,14 +1994,14 @@ KIO::WorkerResult AfpWorker::put(const QUrl &url, int permissions, KIO::JobFlags
     // Write loop — read data from KIO
     unsigned long long offset = 0;
     int readResult = 0;
+    TransferMeter meter;
 
     while (true) {
         QByteArray buf;
-        dataReq();
-        readResult = readData(buf);
+        readResult = fetchData(buf);
         if (readResult < 0) {
             qCDebug(logAfp) << "kio-afp: put readData failed:" << readResult;
-            afp_sl_close(&m_volumeId, fileId);
+            afpCall(AfpCall::Close, afp_sl_close, &m_volumeId, fileId);
             return KIO::WorkerResult::fail(KIO::ERR_CANNOT_WRITE,
                                            i18n("Error reading data from client"));
         }
@@ -1045,25 +2009,31 @@ KIO::WorkerResult AfpWorker::put(const QUrl &url, int permissions, KIO::JobFlags
             break;
 
         unsigned int written = 0;
-        ret = afp_sl_write(&m_volumeId, fileId, 0 /* data fork */,
-                           offset, static_cast<unsigned int>(buf.size()),
-                           &written, buf.constData());
+        ret = afpTransfer(AfpCall::Write, &written, afp_sl_write, &m_volumeId, fileId,
+                          0 /* data fork */, offset, static_cast<unsigned int>(buf.size()),
+                          &written, buf.constData());
         if (ret != AFP_SERVER_RESULT_OKAY) {
             qCDebug(logAfp) << "kio-afp: put write failed at offset" << offset
                             << "ret=" << ret;
-            afp_sl_close(&m_volumeId, fileId);
+            afpCall(AfpCall::Close, afp_sl_close, &m_volumeId, fileId);
             return mapAfpError(ret, pu.path);
         }
         offset += written;
+        if (meter.add(written))
+            emitProgress(offset, meter.rate());
     }
 
-    afp_sl_close(&m_volumeId, fileId);
+    afpCall(AfpCall::Close, afp_sl_close, &m_volumeId, fileId);
     qCDebug(logAfp) << "kio-afp: put complete, wrote" << offset << "bytes";
+    opTimer.setBytes(static_cast<qint64>(offset));
+    finishTransfer(KioOp::Put, meter);
+    if (!exists)
+        invalidateRootStat(pu);
 
     // Set permissions after writing (non-fatal if it fails)
     if (permissions != -1) {
-        ret = afp_sl_chmod(&m_volumeId, pu.afpUrl.path, &pu.afpUrl,
-                           static_cast<mode_t>(permissions));
+        ret = afpCall(AfpCall::Chmod, afp_sl_chmod, &m_volumeId, pu.afpUrl.path, &pu.afpUrl,
+                      static_cast<mode_t>(permissions));
         if (ret != AFP_SERVER_RESULT_OKAY)
             qCDebug(logAfp) << "kio-afp: put chmod failed (non-fatal) ret=" << ret;
     }
@@ -1073,6 +2043,7 @@ KIO::WorkerResult AfpWorker::put(const QUrl &url, int permissions, KIO::JobFlags
 
 KIO::WorkerResult AfpWorker::mkdir(const QUrl &url, int permissions)
 {
+    const OperationTimer opTimer(KioOp::Mkdir);
     qCDebug(logAfp) << "AfpWorker::mkdir()" << url;
 
     ParsedUrl pu = parseAfpUrl(url);
@@ -1084,21 +2055,24 @@ KIO::WorkerResult AfpWorker::mkdir(const QUrl &url, int permissions)
         return r;
 
     mode_t mode = (permissions == -1) ? 0755 : static_cast<mode_t>(permissions);
-    int ret = afp_sl_mkdir(&m_volumeId, pu.afpUrl.path, &pu.afpUrl, mode);
+    int ret = afpCall(AfpCall::Mkdir, afp_sl_mkdir, &m_volumeId, pu.afpUrl.path, &pu.afpUrl, mode);
     if (ret != AFP_SERVER_RESULT_OKAY && isRecoverableSessionError(ret)) {
         invalidateSessionState("mkdir failed");
         if (auto rr = ensureAttached(pu); !rr.success())
             return rr;
-        ret = afp_sl_mkdir(&m_volumeId, pu.afpUrl.path, &pu.afpUrl, mode);
+        ret = afpCall(AfpCall::Mkdir, afp_sl_mkdir, &m_volumeId, pu.afpUrl.path, &pu.afpUrl, mode);
     }
     if (ret != AFP_SERVER_RESULT_OKAY)
         return mapAfpError(ret, pu.path);
 
+    invalidateRootStat(pu);
+    invalidatePathAttrs(pu);
     return KIO::WorkerResult::pass();
 }
 
 KIO::WorkerResult AfpWorker::del(const QUrl &url, bool isFile)
 {
+    const OperationTimer opTimer(KioOp::Del);
     qCDebug(logAfp) << "AfpWorker::del()" << url << "isFile:" << isFile;
 
     ParsedUrl pu = parseAfpUrl(url);
@@ -1108,30 +2082,102 @@ KIO::WorkerResult AfpWorker::del(const QUrl &url, bool isFile)
 
     if (auto r = ensureAttached(pu); !r.success())
         return r;
+    invalidatePathAttrs(pu);
+
+    // With "deleteRecursive" advertised, DeleteJob hands us whole
+    // directory trees instead of one del() per file.
+    if (!isFile && jobMetaData(QStringLiteral("recurse")) == QLatin1String("true")) {
+        DeleteProgress progress;
+        progress.sinceReport.start();
+        QElapsedTimer timer;
+        timer.start();
+        auto r = deleteTree(pu, QByteArray(pu.afpUrl.path), pu.path, progress);
+        qCDebug(logAfp) << "kio-afp: recursive delete removed" << progress.items
+                        << "items," << progress.bytes << "bytes in" << timer.elapsed() << "ms";
+        emitProgress(progress.bytes, 0);
+        if (!r.success())
+            return r;
+    } else if (auto r = removePath(pu, pu.afpUrl.path, !isFile, pu.path); !r.success()) {
+        return r;
+    }
 
-    int ret;
-    if (isFile)
-        ret = afp_sl_unlink(&m_volumeId, pu.afpUrl.path, &pu.afpUrl);
-    else
-        ret = afp_sl_rmdir(&m_volumeId, pu.afpUrl.path, &pu.afpUrl);
+    invalidateRootStat(pu);
+    return KIO::WorkerResult::pass();
+}
+
+KIO::WorkerResult AfpWorker::removePath(ParsedUrl &pu, const char *path, bool isDir,
+                                        const QString &displayPath)
+{
+    int ret = isDir ? afpCall(AfpCall::Rmdir, afp_sl_rmdir, &m_volumeId, path, &pu.afpUrl)
+                    : afpCall(AfpCall::Unlink, afp_sl_unlink, &m_volumeId, path, &pu.afpUrl);
     if (ret != AFP_SERVER_RESULT_OKAY && isRecoverableSessionError(ret)) {
         invalidateSessionState("delete failed");
         if (auto rr = ensureAttached(pu); !rr.success())
             return rr;
-        if (isFile)
-            ret = afp_sl_unlink(&m_volumeId, pu.afpUrl.path, &pu.afpUrl);
-        else
-            ret = afp_sl_rmdir(&m_volumeId, pu.afpUrl.path, &pu.afpUrl);
+        ret = isDir ? afpCall(AfpCall::Rmdir, afp_sl_rmdir, &m_volumeId, path, &pu.afpUrl)
+                    : afpCall(AfpCall::Unlink, afp_sl_unlink, &m_volumeId, path, &pu.afpUrl);
     }
 
     if (ret != AFP_SERVER_RESULT_OKAY)
-        return mapAfpError(ret, pu.path);
+        return mapAfpError(ret, displayPath);
+    return KIO::WorkerResult::pass();
+}
+
+KIO::WorkerResult AfpWorker::deleteTree(ParsedUrl &pu, const QByteArray &dirPath,
+                                        const QString &displayPath, DeleteProgress &progress)
+{
+    // Read the complete listing before removing anything: enumeration is
+    // by offset, so deleting while paging would skip entries.
+    struct Child {
+        QByteArray name;
+        bool isDir;
+        KIO::filesize_t size;
+    };
+    constexpr int DELETE_BATCH = 256;
+    QList<Child> children;
+    if (auto r = readDirectory(pu, dirPath.constData(), DELETE_BATCH, DELETE_BATCH, displayPath,
+                               [&children](const struct afp_file_info_basic *fpb, unsigned int numFiles) {
+                                   for (unsigned int i = 0; i < numFiles; ++i)
+                                       children.append({ QByteArray(fpb[i].name),
+                                                         S_ISDIR(fpb[i].unixprivs.permissions),
+                                                         static_cast<KIO::filesize_t>(fpb[i].size) });
+                               });
+        !r.success())
+        return r;
+
+    for (const Child &child : std::as_const(children)) {
+        if (jobKilled())
+            return KIO::WorkerResult::fail(KIO::ERR_USER_CANCELED, displayPath);
 
+        const QByteArray childPath = dirPath + '/' + child.name;
+        const QString childDisplay = displayPath + QLatin1Char('/') + m_pathCodec.decodeName(child.name.constData());
+        auto r = child.isDir ? deleteTree(pu, childPath, childDisplay, progress)
+                             : removePath(pu, childPath.constData(), false, childDisplay);
+        if (!r.success())
+            return r;
+        if (!child.isDir) {
+            ++progress.items;
+            progress.bytes += child.size;
+        }
+
+        // The freed bytes drive the job's progress; the item count has
+        // no other place to go
+        if (progress.sinceReport.elapsed() >= 250) {
+            emitProgress(progress.bytes, 0);
+            infoMessage(i18np("Deleted %1 item", "Deleted %1 items", progress.items));
+            progress.sinceReport.restart();
+        }
+    }
+
+    if (auto r = removePath(pu, dirPath.constData(), true, displayPath); !r.success())
+        return r;
+    ++progress.items;
     return KIO::WorkerResult::pass();
 }
 
 KIO::WorkerResult AfpWorker::rename(const QUrl &src, const QUrl &dest, KIO::JobFlags flags)
 {
+    const OperationTimer opTimer(KioOp::Rename);
     qCDebug(logAfp) << "AfpWorker::rename()" << src << "->" << dest;
 
     ParsedUrl puSrc = parseAfpUrl(src);
@@ -1147,32 +2193,37 @@ KIO::WorkerResult AfpWorker::rename(const QUrl &src, const QUrl &dest, KIO::JobF
 
     if (auto r = ensureAttached(puSrc); !r.success())
         return r;
+    invalidatePathAttrs(puSrc);
+    invalidatePathAttrs(puDest);
 
     // Check if destination exists when Overwrite is not set
     if (!(flags & KIO::Overwrite)) {
         struct stat st {};
-        if (int check = afp_sl_stat(&m_volumeId, puDest.afpUrl.path, &puDest.afpUrl, &st);
+        if (int check = afpCall(AfpCall::Stat, afp_sl_stat, &m_volumeId, puDest.afpUrl.path, &puDest.afpUrl, &st);
             check == AFP_SERVER_RESULT_OKAY)
             return KIO::WorkerResult::fail(KIO::ERR_FILE_ALREADY_EXIST, puDest.path);
     }
 
-    int ret = afp_sl_rename(&m_volumeId, puSrc.afpUrl.path, puDest.afpUrl.path,
-                            &puSrc.afpUrl);
+    int ret = afpCall(AfpCall::Rename, afp_sl_rename, &m_volumeId, puSrc.afpUrl.path, puDest.afpUrl.path,
+                      &puSrc.afpUrl);
     if (ret != AFP_SERVER_RESULT_OKAY && isRecoverableSessionError(ret)) {
         invalidateSessionState("rename failed");
         if (auto rr = ensureAttached(puSrc); !rr.success())
             return rr;
-        ret = afp_sl_rename(&m_volumeId, puSrc.afpUrl.path, puDest.afpUrl.path,
-                            &puSrc.afpUrl);
+        ret = afpCall(AfpCall::Rename, afp_sl_rename, &m_volumeId, puSrc.afpUrl.path, puDest.afpUrl.path,
+                      &puSrc.afpUrl);
     }
     if (ret != AFP_SERVER_RESULT_OKAY)
         return mapAfpError(ret, puSrc.path);
 
+    invalidateRootStat(puSrc);
+    invalidateRootStat(puDest);
     return KIO::WorkerResult::pass();
 }
 
 KIO::WorkerResult AfpWorker::chmod(const QUrl &url, int permissions)
 {
+    const OperationTimer opTimer(KioOp::Chmod);
     qCDebug(logAfp) << "AfpWorker::chmod()" << url;
 
     ParsedUrl pu = parseAfpUrl(url);
@@ -1183,23 +2234,25 @@ KIO::WorkerResult AfpWorker::chmod(const QUrl &url, int permissions)
     if (auto r = ensureAttached(pu); !r.success())
         return r;
 
-    int ret = afp_sl_chmod(&m_volumeId, pu.afpUrl.path, &pu.afpUrl,
-                           static_cast<mode_t>(permissions));
+    int ret = afpCall(AfpCall::Chmod, afp_sl_chmod, &m_volumeId, pu.afpUrl.path, &pu.afpUrl,
+                      static_cast<mode_t>(permissions));
     if (ret != AFP_SERVER_RESULT_OKAY && isRecoverableSessionError(ret)) {
         invalidateSessionState("chmod failed");
         if (auto rr = ensureAttached(pu); !rr.success())
             return rr;
-        ret = afp_sl_chmod(&m_volumeId, pu.afpUrl.path, &pu.afpUrl,
-                           static_cast<mode_t>(permissions));
+        ret = afpCall(AfpCall::Chmod, afp_sl_chmod, &m_volumeId, pu.afpUrl.path, &pu.afpUrl,
+                      static_cast<mode_t>(permissions));
     }
     if (ret != AFP_SERVER_RESULT_OKAY)
         return mapAfpError(ret, pu.path);
 
+    invalidatePathAttrs(pu);
     return KIO::WorkerResult::pass();
 }
 
 KIO::WorkerResult AfpWorker::fileSystemFreeSpace(const QUrl &url)
 {
+    const OperationTimer opTimer(KioOp::FreeSpace);
     qCDebug(logAfp) << "kio-afp: fileSystemFreeSpace()" << url;
 
     ParsedUrl pu = parseAfpUrl(url);
@@ -1207,12 +2260,12 @@ KIO::WorkerResult AfpWorker::fileSystemFreeSpace(const QUrl &url)
         return r;
 
     struct statvfs svfs {};
-    int ret = afp_sl_statfs(&m_volumeId, "/", &pu.afpUrl, &svfs);
+    int ret = afpCall(AfpCall::Statfs, afp_sl_statfs, &m_volumeId, "/", &pu.afpUrl, &svfs);
     if (ret != AFP_SERVER_RESULT_OKAY && isRecoverableSessionError(ret)) {
         invalidateSessionState("statfs failed");
         if (auto rr = ensureAttached(pu); !rr.success())
             return rr;
-        ret = afp_sl_statfs(&m_volumeId, "/", &pu.afpUrl, &svfs);
+        ret = afpCall(AfpCall::Statfs, afp_sl_statfs, &m_volumeId, "/", &pu.afpUrl, &svfs);
     }
     if (ret != AFP_SERVER_RESULT_OKAY) {
         qCDebug(logAfp) << "kio-afp: statfs failed ret=" << ret;
@@ -1230,6 +2283,31 @@ KIO::WorkerResult AfpWorker::fileSystemFreeSpace(const QUrl &url)
     return KIO::WorkerResult::pass();
 }
 
+KIO::WorkerResult AfpWorker::special(const QByteArray &data)
+{
+    const OperationTimer opTimer(KioOp::Special);
+
+    QDataStream stream(data);
+    int command = 0;
+    stream >> command;
+    qCDebug(logAfp) << "kio-afp: special() command=" << command;
+
+    switch (command) {
+    case SpecialStats:
+        setMetaData(QStringLiteral("stats"), QString::fromUtf8(AfpStats::instance().toJson()));
+        return KIO::WorkerResult::pass();
+    case SpecialResetStats:
+        AfpStats::instance().reset();
+        return KIO::WorkerResult::pass();
+    case SpecialWireStats:
+        setMetaData(QStringLiteral("wirestats"),
+                    QString::fromUtf8(QJsonDocument(AfpStats::instance().wireJson()).toJson()));
+        return KIO::WorkerResult::pass();
+    default:
+        return KIO::WorkerResult::fail(KIO::ERR_UNSUPPORTED_ACTION, QString::number(command));
+    }
+}
+
 // ---------------------------------------------------------------------------
 // Entry points
 // ---------------------------------------------------------------------------
@@ -1237,21 +2315,37 @@ KIO::WorkerResult AfpWorker::fileSystemFreeSpace(const QUrl &url)
 extern "C" {
 int Q_DECL_EXPORT kdemain(int argc, char **argv)
 {
+    // Startup is kept to the minimum KIO needs.  Translations, the MIME
+    // database and the afpsld connection are set up on first use; all
+    // i18n() calls carry TRANSLATION_DOMAIN, so no application domain
+    // is needed.
+    QElapsedTimer startup;
+    startup.start();
+
     QCoreApplication app(argc, argv);
     QCoreApplication::setApplicationName(QStringLiteral("kio-afp"));
-    KLocalizedString::setApplicationDomain(TRANSLATION_DOMAIN);
-    if (argc < 4) {
+    const qint64 appNsecs = startup.nsecsElapsed();
+
+    // --startup-profile runs the same initialisation as a real worker,
+    // reports it and exits before dispatchLoop(); see benchmarks/startup.sh
+    const bool profileOnly = argc >= 2 && qstrcmp(argv[1], "--startup-profile") == 0;
+    if (argc < 4 && !profileOnly) {
         fprintf(stderr, "Usage: kio-afp protocol pool app\n");
         return 1;
     }
 
-    AfpWorker worker(argv[2], argv[3]);
+    AfpWorker worker(profileOnly ? QByteArray() : QByteArray(argv[2]),
+                     profileOnly ? QByteArray() : QByteArray(argv[3]));
+    const qint64 workerNsecs = startup.nsecsElapsed();
+
+    if (profileOnly || qEnvironmentVariableIsSet("KIO_AFP_STARTUP_PROFILE")) {
+        fprintf(stderr, "kio-afp: startup application=%.3f ms worker=%.3f ms\n",
+                appNsecs / 1e6, (workerNsecs - appNsecs) / 1e6);
+    }
+    if (profileOnly)
+        return 0;
+
     worker.dispatchLoop();
     return 0;
 }
 }
-
-int main(int argc, char **argv)
-{
-    return kdemain(argc, argv);
-}
@@ -0,0 +1,242 @@
+/*
+ * Copyright (C) 2025-2026 Daniel Markstedt <daniel@mindani.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef KAFP_WORKER_H
+#define KAFP_WORKER_H
+
+#include <KIO/WorkerBase>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <sys/stat.h>
+#include <thread>
+
+#include "kafp_stats.h"
+#include "kafp_url.h"
+
+extern "C" {
+#include <afp.h>
+#include <afp_server.h>
+#include <afpsl.h>
+}
+
+// State shared between the worker and a background afp_sl_connect() call.
+// Held by shared_ptr so an attempt abandoned on timeout or cancellation can
+// still run to completion after the worker has moved on.
+struct ConnectAttempt {
+    std::mutex mutex;
+    std::condition_variable done;
+    bool finished = false;
+    struct afp_url url {};
+    unsigned int uamMask = 0;
+    serverid_t sid = nullptr;
+    char loginmesg[AFP_LOGINMESG_LEN] = {};
+    int connectError = 0;
+    int ret = AFP_SERVER_RESULT_DAEMON_ERROR;
+};
+
+// Cached volume list of one server
+struct VolumeListCache {
+    QList<struct afp_volume_summary> volumes;
+    QElapsedTimer age;
+};
+
+// Cached attributes of a volume root
+struct RootStatCache {
+    struct stat st {};
+    QElapsedTimer age;
+};
+
+// Cached attributes of a path within a volume
+struct PathAttrCache {
+    struct stat st {};
+    QElapsedTimer age;
+};
+
+// Cached attributes of the entries of one directory
+struct DirAttrCache {
+    QHash<QString, PathAttrCache> entries; // by name
+    quint64 lastUse = 0;
+};
+
+// Progress of a recursive delete
+struct DeleteProgress {
+    qint64 items = 0;
+    KIO::filesize_t bytes = 0; // in the files removed
+    QElapsedTimer sinceReport;
+};
+
+class AfpWorker : public KIO::WorkerBase {
+public:
+    AfpWorker(const QByteArray &pool, const QByteArray &app)
+        : KIO::WorkerBase("afp", pool, app)
+    {
+    }
+    ~AfpWorker() override;
+
+    KIO::WorkerResult stat(const QUrl &url) override;
+    KIO::WorkerResult listDir(const QUrl &url) override;
+    KIO::WorkerResult get(const QUrl &url) override;
+    KIO::WorkerResult put(const QUrl &url, int permissions, KIO::JobFlags flags) override;
+    KIO::WorkerResult mkdir(const QUrl &url, int permissions) override;
+    KIO::WorkerResult del(const QUrl &url, bool isFile) override;
+    KIO::WorkerResult rename(const QUrl &src, const QUrl &dest, KIO::JobFlags flags) override;
+    KIO::WorkerResult chmod(const QUrl &url, int permissions) override;
+    KIO::WorkerResult fileSystemFreeSpace(const QUrl &url) override;
+    KIO::WorkerResult special(const QByteArray &data) override;
+
+    // Commands understood by special(), sent as a QDataStream-encoded int
+    enum SpecialCommand {
+        SpecialStats = 1, // latency histograms as JSON in the "stats" metadata
+        SpecialResetStats = 2, // also resets the wire counters
+        SpecialWireStats = 3, // per-server/volume counters as JSON in "wirestats"
+    };
+
+protected:
+    // Results and data exchanged with the KIO job.  The defaults forward to
+    // WorkerBase; the benchmark harness and the tests override them to
+    // drive the worker without a job on the other end.
+    virtual void emitStat(const KIO::UDSEntry &entry);
+    virtual void emitEntry(const KIO::UDSEntry &entry);
+    virtual void emitEntries(const KIO::UDSEntryList &entries);
+    virtual void emitData(const QByteArray &data);
+    virtual int fetchData(QByteArray &buffer);
+    virtual void emitProgress(KIO::filesize_t processed, unsigned long bytesPerSecond);
+    virtual QString jobMetaData(const QString &key) const;
+    virtual bool jobKilled() const;
+    // Worker settings from kio_afprc; the tests override this to turn on
+    // what is off by default
+    virtual int settingValue(const QString &key, int defaultValue) const;
+
+private:
+    // --- State ---
+    bool m_connSetupDone = false;
+    QString m_cachedServer;
+    serverid_t m_serverId = nullptr;
+    bool m_sessionAdopted = false; // m_serverId was logged in by another worker
+    QString m_cachedVolume;
+    volumeid_t m_volumeId = nullptr;
+    QHash<QString, volumeid_t> m_attachedVolumes; // on m_cachedServer
+    QHash<QString, VolumeListCache> m_volumeLists; // by server
+    QHash<QString, RootStatCache> m_rootStats; // by volumeKey()
+    QHash<QString, DirAttrCache> m_pathAttrs; // by dirKey()
+    qsizetype m_pathAttrCount = 0; // entries in all directories
+    quint64 m_pathAttrUses = 0;
+    QHash<QString, QString> m_mimeCache; // by last extension
+    AfpPathCodec m_pathCodec;
+    QByteArray m_cachedUser;
+    QByteArray m_cachedPass;
+    std::shared_ptr<ConnectAttempt> m_pendingConnect;
+
+    // Background afpsl work runs alongside the worker's own calls, which
+    // afpTransfer() interleaves.  The task returns a closure that is
+    // applied on the worker thread once it has finished.
+    std::thread m_background;
+    std::function<void()> m_backgroundApply;
+    std::atomic<bool> m_backgroundDone { false };
+    std::atomic<bool> m_cancelBackground { false };
+    QStringList m_backgroundVolumes; // being pre-attached by the task
+
+    // --- URL parsing ---
+    ParsedUrl parseAfpUrl(const QUrl &url);
+    static QString volumeKey(const ParsedUrl &pu);
+
+    // --- Connection lifecycle ---
+    KIO::WorkerResult ensureConnSetup();
+    KIO::WorkerResult ensureConnected(ParsedUrl &pu);
+    KIO::WorkerResult ensureAttached(ParsedUrl &pu);
+    enum class ConnectWait { Finished, TimedOut, Cancelled };
+    std::shared_ptr<ConnectAttempt> startConnect(const ParsedUrl &pu, unsigned int uamMask);
+    ConnectWait waitForConnect(ConnectAttempt &attempt, std::chrono::seconds timeout);
+    KIO::WorkerResult reapPendingConnect(const ParsedUrl &pu);
+    void invalidateSessionState(const char *reason);
+    // Disconnects the session if this worker logged it in, else drops it
+    void releaseSession();
+    bool isRecoverableSessionError(int ret) const;
+
+    // --- Session handoff between worker processes ---
+    static QString sharedSessionPath(const QString &server);
+    bool adoptSharedSession(ParsedUrl &pu);
+    void publishSharedSession() const;
+    void withdrawSharedSession() const;
+
+    // --- Background work / volume warm-up ---
+    void startBackground(std::function<std::function<void()>()> task);
+    // Cancels what the task has not started yet, waits for the call in
+    // flight and applies the results
+    void waitForBackground();
+    // Applies the results of a finished task without waiting
+    void reapBackground();
+    QStringList recentVolumes(const QString &server) const;
+    void rememberVolume(const QString &server, const QString &volume) const;
+    void startBackgroundRefresh(const ParsedUrl &pu, bool refreshVolumeList);
+
+    // --- Volume root attributes ---
+    void cacheRootStat(const ParsedUrl &pu, const struct stat &st);
+    bool cachedRootStat(const ParsedUrl &pu, struct stat &st) const;
+    void invalidateRootStat(const ParsedUrl &pu);
+    bool volumeIsListed(const ParsedUrl &pu) const;
+
+    // --- Path attributes ---
+    // Key of a directory, given by its path within the volume
+    QString dirKey(const ParsedUrl &pu, QStringView dir) const;
+    // Key of the directory holding pu.path
+    QString parentKey(const ParsedUrl &pu) const;
+    // The directory's cache, with room for adding more entries, or null
+    DirAttrCache *dirAttrs(const QString &key, qsizetype adding);
+    void cachePathAttrs(const ParsedUrl &pu, const struct stat &st);
+    // The first count entries of a listing batch and their UDSEntries
+    void cacheListedAttrs(const QString &key, const struct afp_file_info_basic *fpb,
+                          const KIO::UDSEntryList &entries, qsizetype count);
+    bool cachedPathAttrs(const ParsedUrl &pu, struct stat &st) const;
+    void invalidatePathAttrs(const ParsedUrl &pu);
+
+    // --- MIME types ---
+    QString mimeTypeForName(const QString &name);
+
+    // --- UDSEntry helpers ---
+    KIO::UDSEntry statToUDS(const struct stat &st, const QString &name) const;
+    KIO::UDSEntry serverOrVolumeEntry(const QString &name) const;
+    // A volume whose attributes are unknown: no permissions or owner
+    KIO::UDSEntry volumeEntry(const QString &name) const;
+    KIO::UDSEntry volumeSummaryToUDS(const struct afp_volume_summary &vol) const;
+    KIO::UDSEntry fileInfoToUDS(const struct afp_file_info_basic &fi);
+
+    // --- Directory enumeration ---
+    using DirBatchSink = std::function<void(const struct afp_file_info_basic *, unsigned int)>;
+    // Requests firstBatch entries, then twice as many each time up to
+    // maxBatch.  The sink gets a copy of each batch and may call libafpsl.
+    KIO::WorkerResult readDirectory(ParsedUrl &pu, const char *dirPath, int firstBatch,
+                                    int maxBatch, const QString &errorPath,
+                                    const DirBatchSink &sink);
+    KIO::WorkerResult listRecursive(ParsedUrl &pu);
+
+    // --- Deletion ---
+    KIO::WorkerResult removePath(ParsedUrl &pu, const char *path, bool isDir,
+                                 const QString &displayPath);
+    KIO::WorkerResult deleteTree(ParsedUrl &pu, const QByteArray &dirPath,
+                                 const QString &displayPath, DeleteProgress &progress);
+
+    // --- Transfer accounting ---
+    void finishTransfer(KioOp op, const TransferMeter &meter);
+
+    // --- Error mapping ---
+    KIO::WorkerResult mapAfpError(int ret, const QString &path) const;
+    KIO::WorkerResult mapAfpConnectError(int ret, const QString &server) const;
+};
+
+#endif // KAFP_WORKER_H
@@ -0,0 +1,806 @@
+/*
+ * Copyright (C) 2026 Daniel Markstedt <daniel@mindani.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+// In-process stand-in for libafpsl, for measuring the worker's own
+// overhead without an afpsld daemon or an AFP server.  It implements the
+// afp_sl_* calls used by kio-afp on top of an in-memory file tree.
+//
+// Behaviour is configured through the environment:
+//
+//   AFPSL_MOCK_VOLUMES     comma-separated volume names (default "Mock")
+//   AFPSL_MOCK_TREE        synthetic tree on every volume, as
+//                          "dirs=N,files=N,depth=N,size=BYTES"
+//                          (default "dirs=4,files=16,depth=3,size=65536")
+//   AFPSL_MOCK_LATENCY_US  delay added to every call, in microseconds
+//   AFPSL_MOCK_BANDWIDTH   read/write throughput limit in bytes per second
+//   AFPSL_MOCK_CONNECT_US  extra delay of afp_sl_connect (the login), in
+//                          microseconds
+//   AFPSL_MOCK_DAEMON      path of a lock file; every process using the
+//                          mock with the same path serves its calls one at
+//                          a time under it and shares the server session
+//                          through it, like a single afpsld daemon
+//   AFPSL_MOCK_ERRORS      "call:N[:CODE],...": make every Nth call of
+//                          afp_sl_<call> fail with AFP_SERVER_RESULT_<CODE>
+//                          (default code NOTCONNECTED)
+//   AFPSL_MOCK_LOCKED      comma-separated names of entries that unlink and
+//                          rmdir refuse with AFP_SERVER_RESULT_ACCESS
+//   AFPSL_MOCK_SHARED_REPLY
+//                          set to 1 to make every call overwrite the
+//                          entries of the last readdir, like the single
+//                          reply buffer of the real library
+//
+// Load it with LD_PRELOAD in front of a regular worker, or link against it
+// instead of libafpsl.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+extern "C" {
+#include <afp.h>
+#include <afp_server.h>
+#include <afpsl.h>
+}
+
+namespace {
+
+struct Node {
+    bool dir = false;
+    mode_t permissions = 0644;
+    unsigned long long size = 0;
+    time_t ctime = 0;
+    time_t mtime = 0;
+    bool synthetic = false; // content generated from the path
+    std::string content;
+    std::vector<std::string> children; // sorted names, directories only
+};
+
+struct Volume {
+    std::string name;
+    std::map<std::string, Node> nodes; // by absolute path, "/" is the root
+    bool attached = false;
+};
+
+struct OpenFile {
+    Volume *volume;
+    std::string path;
+};
+
+struct ErrorRule {
+    unsigned long every = 0;
+    unsigned long calls = 0;
+    int code = AFP_SERVER_RESULT_NOTCONNECTED;
+};
+
+struct Mock {
+    std::mutex mutex;
+    bool connected = false;
+    std::vector<Volume> volumes;
+    std::map<unsigned int, OpenFile> openFiles;
+    unsigned int nextFileId = 1;
+    std::vector<struct afp_file_info_basic> readdirBuffer;
+
+    long latencyUs = 0;
+    long connectUs = 0;
+    unsigned long long bandwidth = 0;
+    bool sharedReply = false;
+    int daemonFd = -1;
+    std::map<std::string, ErrorRule> errors;
+    std::vector<std::string> locked;
+
+    Mock();
+};
+
+const char *env(const char *name, const char *fallback)
+{
+    const char *value = std::getenv(name);
+    return value && *value ? value : fallback;
+}
+
+std::vector<std::string> splitList(const std::string &s, char sep)
+{
+    std::vector<std::string> parts;
+    size_t pos = 0;
+    while (pos <= s.size()) {
+        size_t end = s.find(sep, pos);
+        if (end == std::string::npos)
+            end = s.size();
+        if (end > pos)
+            parts.push_back(s.substr(pos, end - pos));
+        pos = end + 1;
+    }
+    return parts;
+}
+
+int resultCode(const std::string &name)
+{
+    static const std::map<std::string, int> codes = {
+        { "NOTCONNECTED", AFP_SERVER_RESULT_NOTCONNECTED },
+        { "NOTATTACHED", AFP_SERVER_RESULT_NOTATTACHED },
+        { "TIMEDOUT", AFP_SERVER_RESULT_TIMEDOUT },
+        { "ENOENT", AFP_SERVER_RESULT_ENOENT },
+        { "ACCESS", AFP_SERVER_RESULT_ACCESS },
+        { "EXIST", AFP_SERVER_RESULT_EXIST },
+        { "DAEMON_ERROR", AFP_SERVER_RESULT_DAEMON_ERROR },
+    };
+    const auto it = codes.find(name);
+    return it != codes.end() ? it->second : AFP_SERVER_RESULT_NOTCONNECTED;
+}
+
+std::string childPath(const std::string &dir, const std::string &name)
+{
+    return dir == "/" ? "/" + name : dir + "/" + name;
+}
+
+void addNode(Volume &vol, const std::string &path, Node node)
+{
+    const size_t slash = path.rfind('/');
+    const std::string parent = slash == 0 ? "/" : path.substr(0, slash);
+    std::vector<std::string> &siblings = vol.nodes[parent].children;
+    const std::string name = path.substr(slash + 1);
+    siblings.insert(std::lower_bound(siblings.begin(), siblings.end(), name), name);
+    vol.nodes[path] = std::move(node);
+}
+
+void removeNode(Volume &vol, const std::string &path)
+{
+    const size_t slash = path.rfind('/');
+    const std::string parent = slash == 0 ? "/" : path.substr(0, slash);
+    std::vector<std::string> &siblings = vol.nodes[parent].children;
+    const std::string name = path.substr(slash + 1);
+    if (const auto it = std::lower_bound(siblings.begin(), siblings.end(), name);
+        it != siblings.end() && *it == name)
+        siblings.erase(it);
+    vol.nodes.erase(path);
+}
+
+void buildTree(Volume &vol, const std::string &dir, int dirs, int files, int depth,
+               unsigned long long size, time_t now)
+{
+    // Fill the child list directly and sort it once; inserting in order
+    // would be quadratic for very large directories
+    std::vector<std::string> names;
+    names.reserve(static_cast<size_t>(files) + (depth > 0 ? dirs : 0));
+
+    for (int i = 0; i < files; ++i) {
+        Node file;
+        file.size = size;
+        file.ctime = file.mtime = now;
+        file.synthetic = true;
+        names.push_back("file" + std::to_string(i) + ".dat");
+        vol.nodes[childPath(dir, names.back())] = std::move(file);
+    }
+    if (depth > 0) {
+        for (int i = 0; i < dirs; ++i) {
+            Node sub;
+            sub.dir = true;
+            sub.permissions = 0755;
+            sub.ctime = sub.mtime = now;
+            names.push_back("dir" + std::to_string(i));
+            const std::string path = childPath(dir, names.back());
+            vol.nodes[path] = std::move(sub);
+            buildTree(vol, path, dirs, files, depth - 1, size, now);
+        }
+    }
+
+    std::sort(names.begin(), names.end());
+    vol.nodes[dir].children = std::move(names);
+}
+
+Mock::Mock()
+{
+    latencyUs = std::atol(env("AFPSL_MOCK_LATENCY_US", "0"));
+    connectUs = std::atol(env("AFPSL_MOCK_CONNECT_US", "0"));
+    bandwidth = std::strtoull(env("AFPSL_MOCK_BANDWIDTH", "0"), nullptr, 10);
+    sharedReply = std::atoi(env("AFPSL_MOCK_SHARED_REPLY", "0")) != 0;
+    if (const char *daemon = env("AFPSL_MOCK_DAEMON", nullptr))
+        daemonFd = ::open(daemon, O_CREAT | O_RDWR | O_CLOEXEC, 0600);
+
+    for (const std::string &rule : splitList(env("AFPSL_MOCK_ERRORS", ""), ',')) {
+        const std::vector<std::string> fields = splitList(rule, ':');
+        if (fields.size() < 2)
+            continue;
+        ErrorRule &error = errors[fields[0]];
+        error.every = std::strtoul(fields[1].c_str(), nullptr, 10);
+        if (fields.size() > 2)
+            error.code = resultCode(fields[2]);
+    }
+
+    locked = splitList(env("AFPSL_MOCK_LOCKED", ""), ',');
+
+    int dirs = 4, files = 16, depth = 3;
+    unsigned long long size = 65536;
+    for (const std::string &field : splitList(env("AFPSL_MOCK_TREE", ""), ',')) {
+        const size_t eq = field.find('=');
+        if (eq == std::string::npos)
+            continue;
+        const std::string key = field.substr(0, eq);
+        const unsigned long long value = std::strtoull(field.c_str() + eq + 1, nullptr, 10);
+        if (key == "dirs")
+            dirs = static_cast<int>(value);
+        else if (key == "files")
+            files = static_cast<int>(value);
+        else if (key == "depth")
+            depth = static_cast<int>(value);
+        else if (key == "size")
+            size = value;
+    }
+
+    const time_t now = std::time(nullptr);
+    for (const std::string &name : splitList(env("AFPSL_MOCK_VOLUMES", "Mock"), ',')) {
+        Volume vol;
+        vol.name = name;
+        Node &root = vol.nodes["/"];
+        root.dir = true;
+        root.permissions = 0755;
+        root.ctime = root.mtime = now;
+        buildTree(vol, "/", dirs, files, depth, size, now);
+        volumes.push_back(std::move(vol));
+    }
+}
+
+Mock &mock()
+{
+    static Mock instance;
+    return instance;
+}
+
+// Common prologue of every call: simulated latency, the shared reply
+// buffer and error injection.
+// Returns AFP_SERVER_RESULT_OKAY when the call should proceed.
+int enter(Mock &m, const char *call, long extraUs = 0)
+{
+    if (const long us = m.latencyUs + extraUs; us > 0) {
+        // The shared daemon handles one request at a time
+        if (m.daemonFd >= 0)
+            flock(m.daemonFd, LOCK_EX);
+        std::this_thread::sleep_for(std::chrono::microseconds(us));
+        if (m.daemonFd >= 0)
+            flock(m.daemonFd, LOCK_UN);
+    }
+
+    if (m.sharedReply) {
+        for (struct afp_file_info_basic &fi : m.readdirBuffer) {
+            fi = afp_file_info_basic {};
+            std::strncpy(fi.name, "<overwritten>", sizeof(fi.name) - 1);
+        }
+    }
+
+    const auto it = m.errors.find(call);
+    if (it != m.errors.end() && it->second.every > 0
+        && ++it->second.calls % it->second.every == 0)
+        return it->second.code;
+    return AFP_SERVER_RESULT_OKAY;
+}
+
+// With a shared daemon the session lives in its lock file: one byte
+// while connected
+bool isConnected(const Mock &m)
+{
+    struct stat st {};
+    if (m.daemonFd >= 0)
+        return ::fstat(m.daemonFd, &st) == 0 && st.st_size > 0;
+    return m.connected;
+}
+
+void setConnected(Mock &m, bool connected)
+{
+    m.connected = connected;
+    if (m.daemonFd >= 0) {
+        [[maybe_unused]] const int ret = ::ftruncate(m.daemonFd, connected ? 1 : 0);
+    }
+}
+
+void transferDelay(const Mock &m, unsigned long long bytes)
+{
+    if (m.bandwidth > 0 && bytes > 0)
+        std::this_thread::sleep_for(std::chrono::microseconds(bytes * 1000000ULL / m.bandwidth));
+}
+
+Volume *findVolume(Mock &m, const char *name)
+{
+    for (Volume &vol : m.volumes) {
+        if (vol.name == name)
+            return &vol;
+    }
+    return nullptr;
+}
+
+Volume *fromId(Mock &m, volumeid_t *volid)
+{
+    if (!volid || !*volid)
+        return nullptr;
+    const auto index = reinterpret_cast<uintptr_t>(*volid) - 1;
+    if (index >= m.volumes.size() || !m.volumes[index].attached)
+        return nullptr;
+    return &m.volumes[index];
+}
+
+volumeid_t toId(const Mock &m, const Volume *vol)
+{
+    return reinterpret_cast<volumeid_t>(static_cast<uintptr_t>(vol - m.volumes.data()) + 1);
+}
+
+std::string normalise(const char *path)
+{
+    std::string p = path && *path ? path : "/";
+    while (p.size() > 1 && p.back() == '/')
+        p.pop_back();
+    return p;
+}
+
+char syntheticByte(unsigned long long offset)
+{
+    return static_cast<char>((offset * 31 + 7) & 0xff);
+}
+
+// Turn generated content into stored content before modifying it
+void materialise(Node &node)
+{
+    if (!node.synthetic)
+        return;
+    node.content.resize(node.size);
+    for (unsigned long long i = 0; i < node.size; ++i)
+        node.content[i] = syntheticByte(i);
+    node.synthetic = false;
+}
+
+int createNode(const char *call, volumeid_t *volid, const char *path, mode_t mode, bool dir)
+{
+    Mock &m = mock();
+    std::lock_guard<std::mutex> lock(m.mutex);
+    if (int ret = enter(m, call); ret != AFP_SERVER_RESULT_OKAY)
+        return ret;
+    Volume *vol = fromId(m, volid);
+    if (!vol)
+        return AFP_SERVER_RESULT_NOTATTACHED;
+
+    const std::string p = normalise(path);
+    if (vol->nodes.count(p))
+        return AFP_SERVER_RESULT_EXIST;
+    const size_t slash = p.rfind('/');
+    const auto parent = vol->nodes.find(slash == 0 ? "/" : p.substr(0, slash));
+    if (parent == vol->nodes.end() || !parent->second.dir)
+        return AFP_SERVER_RESULT_ENOENT;
+
+    Node node;
+    node.dir = dir;
+    node.permissions = mode & 07777;
+    node.ctime = node.mtime = std::time(nullptr);
+    parent->second.mtime = node.mtime;
+    addNode(*vol, p, std::move(node));
+    return AFP_SERVER_RESULT_OKAY;
+}
+
+int removeEntry(const char *call, volumeid_t *volid, const char *path, bool dir)
+{
+    Mock &m = mock();
+    std::lock_guard<std::mutex> lock(m.mutex);
+    if (int ret = enter(m, call); ret != AFP_SERVER_RESULT_OKAY)
+        return ret;
+    Volume *vol = fromId(m, volid);
+    if (!vol)
+        return AFP_SERVER_RESULT_NOTATTACHED;
+
+    const std::string p = normalise(path);
+    const auto it = vol->nodes.find(p);
+    if (it == vol->nodes.end() || p == "/")
+        return AFP_SERVER_RESULT_ENOENT;
+    if (it->second.dir != dir)
+        return AFP_SERVER_RESULT_NOTSUPPORTED;
+    if (dir && !it->second.children.empty())
+        return AFP_SERVER_RESULT_ACCESS;
+    if (std::find(m.locked.begin(), m.locked.end(), p.substr(p.rfind('/') + 1)) != m.locked.end())
+        return AFP_SERVER_RESULT_ACCESS;
+    removeNode(*vol, p);
+    return AFP_SERVER_RESULT_OKAY;
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// Connection and volumes
+// ---------------------------------------------------------------------------
+
+extern "C" {
+
+void afp_sl_conn_setup(void)
+{
+    mock();
+}
+
+int afp_sl_connect(struct afp_url *url, unsigned int, serverid_t *id, char *loginmesg, int *error)
+{
+    Mock &m = mock();
+    std::lock_guard<std::mutex> lock(m.mutex);
+    if (error)
+        *error = 0;
+    if (loginmesg)
+        loginmesg[0] = '\0';
+    if (int ret = enter(m, "connect", m.connectUs); ret != AFP_SERVER_RESULT_OKAY)
+        return ret;
+    if (!url || !url->servername[0])
+        return AFP_SERVER_RESULT_NOSERVER;
+
+    const bool already = isConnected(m);
+    setConnected(m, true);
+    *id = reinterpret_cast<serverid_t>(&m);
+    return already ? AFP_SERVER_RESULT_ALREADY_CONNECTED : AFP_SERVER_RESULT_OKAY;
+}
+
+int afp_sl_disconnect(serverid_t *id)
+{
+    Mock &m = mock();
+    std::lock_guard<std::mutex> lock(m.mutex);
+    setConnected(m, false);
+    for (Volume &vol : m.volumes)
+        vol.attached = false;
+    m.openFiles.clear();
+    if (id)
+        *id = nullptr;
+    return AFP_SERVER_RESULT_OKAY;
+}
+
+int afp_sl_getvols(struct afp_url *, unsigned int start, unsigned int count,
+                   unsigned int *numvols, struct afp_volume_summary *vols)
+{
+    Mock &m = mock();
+    std::lock_guard<std::mutex> lock(m.mutex);
+    *numvols = 0;
+    if (int ret = enter(m, "getvols"); ret != AFP_SERVER_RESULT_OKAY)
+        return ret;
+    if (!isConnected(m))
+        return AFP_SERVER_RESULT_NOTCONNECTED;
+
+    for (size_t i = start; i < m.volumes.size() && *numvols < count; ++i) {
+        struct afp_volume_summary &summary = vols[(*numvols)++];
+        std::memset(&summary, 0, sizeof(summary));
+        std::strncpy(summary.volume_name_printable, m.volumes[i].name.c_str(),
+                     sizeof(summary.volume_name_printable) - 1);
+    }
+    return AFP_SERVER_RESULT_OKAY;
+}
+
+int afp_sl_attach(struct afp_url *url, unsigned int, volumeid_t *volumeid)
+{
+    Mock &m = mock();
+    std::lock_guard<std::mutex> lock(m.mutex);
+    if (int ret = enter(m, "attach"); ret != AFP_SERVER_RESULT_OKAY)
+        return ret;
+    if (!isConnected(m))
+        return AFP_SERVER_RESULT_NOTCONNECTED;
+
+    Volume *vol = findVolume(m, url->volumename);
+    if (!vol)
+        return AFP_SERVER_RESULT_NOVOLUME;
+    // Like afpsld, report a volume that is already attached without
+    // handing out its id; callers look it up with afp_sl_getvolid()
+    if (vol->attached)
+        return AFP_SERVER_RESULT_ALREADY_ATTACHED;
+    vol->attached = true;
+    *volumeid = toId(m, vol);
+    return AFP_SERVER_RESULT_OKAY;
+}
+
+int afp_sl_getvolid(struct afp_url *url, volumeid_t *volid)
+{
+    Mock &m = mock();
+    std::lock_guard<std::mutex> lock(m.mutex);
+    if (int ret = enter(m, "getvolid"); ret != AFP_SERVER_RESULT_OKAY)
+        return ret;
+
+    Volume *vol = findVolume(m, url->volumename);
+    if (!vol || !vol->attached)
+        return AFP_SERVER_RESULT_NOTATTACHED;
+    *volid = toId(m, vol);
+    return AFP_SERVER_RESULT_OKAY;
+}
+
+// ---------------------------------------------------------------------------
+// Metadata
+// ---------------------------------------------------------------------------
+
+int afp_sl_stat(volumeid_t *volid, const char *path, struct afp_url *, struct stat *st)
+{
+    Mock &m = mock();
+    std::lock_guard<std::mutex> lock(m.mutex);
+    if (int ret = enter(m, "stat"); ret != AFP_SERVER_RESULT_OKAY)
+        return ret;
+    Volume *vol = fromId(m, volid);
+    if (!vol)
+        return AFP_SERVER_RESULT_NOTATTACHED;
+
+    const auto it = vol->nodes.find(normalise(path));
+    if (it == vol->nodes.end())
+        return AFP_SERVER_RESULT_ENOENT;
+
+    const Node &node = it->second;
+    std::memset(st, 0, sizeof(*st));
+    st->st_mode = (node.dir ? S_IFDIR : S_IFREG) | node.permissions;
+    st->st_nlink = 1;
+    st->st_uid = getuid();
+    st->st_gid = getgid();
+    st->st_size = static_cast<off_t>(node.size);
+    st->st_ctime = node.ctime;
+    st->st_mtime = node.mtime;
+    return AFP_SERVER_RESULT_OKAY;
+}
+
+int afp_sl_readdir(volumeid_t *volid, const char *path, struct afp_url *, int start, int count,
+                   unsigned int *numfiles, struct afp_file_info_basic **fpb, int *eod)
+{
+    Mock &m = mock();
+    std::lock_guard<std::mutex> lock(m.mutex);
+    *numfiles = 0;
+    *eod = 0;
+    if (int ret = enter(m, "readdir"); ret != AFP_SERVER_RESULT_OKAY)
+        return ret;
+    Volume *vol = fromId(m, volid);
+    if (!vol)
+        return AFP_SERVER_RESULT_NOTATTACHED;
+
+    const std::string dir = normalise(path);
+    const auto it = vol->nodes.find(dir);
+    if (it == vol->nodes.end())
+        return AFP_SERVER_RESULT_ENOENT;
+    if (!it->second.dir)
+        return AFP_SERVER_RESULT_NOTSUPPORTED;
+
+    // Like the real library, the entries live in a buffer owned by the
+    // library that stays valid until the next call
+    const std::vector<std::string> &children = it->second.children;
+    const size_t first = std::min(static_cast<size_t>(std::max(start, 0)), children.size());
+    const size_t last = std::min(first + static_cast<size_t>(std::max(count, 0)), children.size());
+    m.readdirBuffer.assign(last - first, afp_file_info_basic {});
+    for (size_t i = first; i < last; ++i) {
+        const Node &node = vol->nodes[childPath(dir, children[i])];
+        struct afp_file_info_basic &fi = m.readdirBuffer[i - first];
+        std::strncpy(fi.name, children[i].c_str(), sizeof(fi.name) - 1);
+        fi.creation_date = static_cast<unsigned int>(node.ctime);
+        fi.modification_date = static_cast<unsigned int>(node.mtime);
+        fi.unixprivs.permissions = (node.dir ? S_IFDIR : S_IFREG) | node.permissions;
+        fi.unixprivs.uid = getuid();
+        fi.unixprivs.gid = getgid();
+        fi.size = node.size;
+    }
+
+    *numfiles = static_cast<unsigned int>(last - first);
+    *fpb = m.readdirBuffer.data();
+    *eod = last >= children.size();
+    return AFP_SERVER_RESULT_OKAY;
+}
+
+int afp_sl_statfs(volumeid_t *volid, const char *, struct afp_url *, struct statvfs *svfs)
+{
+    Mock &m = mock();
+    std::lock_guard<std::mutex> lock(m.mutex);
+    if (int ret = enter(m, "statfs"); ret != AFP_SERVER_RESULT_OKAY)
+        return ret;
+    if (!fromId(m, volid))
+        return AFP_SERVER_RESULT_NOTATTACHED;
+
+    std::memset(svfs, 0, sizeof(*svfs));
+    svfs->f_bsize = svfs->f_frsize = 4096;
+    svfs->f_blocks = 1ULL << 28; // 1 TiB
+    svfs->f_bfree = svfs->f_bavail = 1ULL << 27;
+    return AFP_SERVER_RESULT_OKAY;
+}
+
+int afp_sl_chmod(volumeid_t *volid, const char *path, struct afp_url *, mode_t mode)
+{
+    Mock &m = mock();
+    std::lock_guard<std::mutex> lock(m.mutex);
+    if (int ret = enter(m, "chmod"); ret != AFP_SERVER_RESULT_OKAY)
+        return ret;
+    Volume *vol = fromId(m, volid);
+    if (!vol)
+        return AFP_SERVER_RESULT_NOTATTACHED;
+
+    const auto it = vol->nodes.find(normalise(path));
+    if (it == vol->nodes.end())
+        return AFP_SERVER_RESULT_ENOENT;
+    it->second.permissions = mode & 07777;
+    return AFP_SERVER_RESULT_OKAY;
+}
+
+// ---------------------------------------------------------------------------
+// Namespace changes
+// ---------------------------------------------------------------------------
+
+int afp_sl_creat(volumeid_t *volid, const char *path, struct afp_url *, mode_t mode)
+{
+    return createNode("creat", volid, path, mode, false);
+}
+
+int afp_sl_mkdir(volumeid_t *volid, const char *path, struct afp_url *, mode_t mode)
+{
+    return createNode("mkdir", volid, path, mode, true);
+}
+
+int afp_sl_unlink(volumeid_t *volid, const char *path, struct afp_url *)
+{
+    return removeEntry("unlink", volid, path, false);
+}
+
+int afp_sl_rmdir(volumeid_t *volid, const char *path, struct afp_url *)
+{
+    return removeEntry("rmdir", volid, path, true);
+}
+
+int afp_sl_rename(volumeid_t *volid, const char *from, const char *to, struct afp_url *)
+{
+    Mock &m = mock();
+    std::lock_guard<std::mutex> lock(m.mutex);
+    if (int ret = enter(m, "rename"); ret != AFP_SERVER_RESULT_OKAY)
+        return ret;
+    Volume *vol = fromId(m, volid);
+    if (!vol)
+        return AFP_SERVER_RESULT_NOTATTACHED;
+
+    const std::string src = normalise(from);
+    const std::string dest = normalise(to);
+    if (!vol->nodes.count(src) || src == "/")
+        return AFP_SERVER_RESULT_ENOENT;
+    if (vol->nodes.count(dest))
+        removeNode(*vol, dest);
+
+    // Move the node and everything below it
+    const std::string prefix = src + "/";
+    std::vector<std::pair<std::string, Node>> descendants;
+    for (auto it = vol->nodes.begin(); it != vol->nodes.end();) {
+        if (it->first.compare(0, prefix.size(), prefix) == 0) {
+            descendants.emplace_back(dest + it->first.substr(src.size()), std::move(it->second));
+            it = vol->nodes.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    Node node = std::move(vol->nodes[src]);
+    removeNode(*vol, src);
+    addNode(*vol, dest, std::move(node));
+    for (auto &[path, child] : descendants)
+        vol->nodes[path] = std::move(child);
+    return AFP_SERVER_RESULT_OKAY;
+}
+
+// ---------------------------------------------------------------------------
+// File data
+// ---------------------------------------------------------------------------
+
+int afp_sl_truncate(volumeid_t *volid, const char *path, struct afp_url *, unsigned long long size)
+{
+    Mock &m = mock();
+    std::lock_guard<std::mutex> lock(m.mutex);
+    if (int ret = enter(m, "truncate"); ret != AFP_SERVER_RESULT_OKAY)
+        return ret;
+    Volume *vol = fromId(m, volid);
+    if (!vol)
+        return AFP_SERVER_RESULT_NOTATTACHED;
+
+    const auto it = vol->nodes.find(normalise(path));
+    if (it == vol->nodes.end() || it->second.dir)
+        return AFP_SERVER_RESULT_ENOENT;
+    Node &node = it->second;
+    materialise(node);
+    node.content.resize(size);
+    node.size = size;
+    node.mtime = std::time(nullptr);
+    return AFP_SERVER_RESULT_OKAY;
+}
+
+int afp_sl_open(volumeid_t *volid, const char *path, struct afp_url *, unsigned int *fileid,
+                unsigned int)
+{
+    Mock &m = mock();
+    std::lock_guard<std::mutex> lock(m.mutex);
+    if (int ret = enter(m, "open"); ret != AFP_SERVER_RESULT_OKAY)
+        return ret;
+    Volume *vol = fromId(m, volid);
+    if (!vol)
+        return AFP_SERVER_RESULT_NOTATTACHED;
+
+    const std::string p = normalise(path);
+    const auto it = vol->nodes.find(p);
+    if (it == vol->nodes.end())
+        return AFP_SERVER_RESULT_ENOENT;
+    if (it->second.dir)
+        return AFP_SERVER_RESULT_NOTSUPPORTED;
+
+    *fileid = m.nextFileId++;
+    m.openFiles[*fileid] = OpenFile { vol, p };
+    return AFP_SERVER_RESULT_OKAY;
+}
+
+int afp_sl_read(volumeid_t *, unsigned int fileid, unsigned int, unsigned long long start,
+                unsigned int length, unsigned int *received, unsigned int *eof, char *data)
+{
+    Mock &m = mock();
+    std::unique_lock<std::mutex> lock(m.mutex);
+    *received = 0;
+    *eof = 0;
+    if (int ret = enter(m, "read"); ret != AFP_SERVER_RESULT_OKAY)
+        return ret;
+
+    const auto file = m.openFiles.find(fileid);
+    if (file == m.openFiles.end())
+        return AFP_SERVER_RESULT_ENOENT;
+    const auto it = file->second.volume->nodes.find(file->second.path);
+    if (it == file->second.volume->nodes.end())
+        return AFP_SERVER_RESULT_ENOENT;
+
+    const Node &node = it->second;
+    const unsigned long long n = start < node.size
+        ? std::min<unsigned long long>(length, node.size - start)
+        : 0;
+    if (node.synthetic) {
+        for (unsigned long long i = 0; i < n; ++i)
+            data[i] = syntheticByte(start + i);
+    } else {
+        std::memcpy(data, node.content.data() + start, n);
+    }
+    *received = static_cast<unsigned int>(n);
+    *eof = start + n >= node.size;
+
+    lock.unlock();
+    transferDelay(m, n);
+    return AFP_SERVER_RESULT_OKAY;
+}
+
+int afp_sl_write(volumeid_t *, unsigned int fileid, unsigned int, unsigned long long offset,
+                 unsigned int size, unsigned int *written, const char *data)
+{
+    Mock &m = mock();
+    std::unique_lock<std::mutex> lock(m.mutex);
+    *written = 0;
+    if (int ret = enter(m, "write"); ret != AFP_SERVER_RESULT_OKAY)
+        return ret;
+
+    const auto file = m.openFiles.find(fileid);
+    if (file == m.openFiles.end())
+        return AFP_SERVER_RESULT_ENOENT;
+    const auto it = file->second.volume->nodes.find(file->second.path);
+    if (it == file->second.volume->nodes.end())
+        return AFP_SERVER_RESULT_ENOENT;
+
+    Node &node = it->second;
+    materialise(node);
+    if (node.content.size() < offset + size)
+        node.content.resize(offset + size);
+    std::memcpy(&node.content[offset], data, size);
+    node.size = node.content.size();
+    node.mtime = std::time(nullptr);
+    *written = size;
+
+    lock.unlock();
+    transferDelay(m, size);
+    return AFP_SERVER_RESULT_OKAY;
+}
+
+int afp_sl_close(volumeid_t *, unsigned int fileid)
+{
+    Mock &m = mock();
+    std::lock_guard<std::mutex> lock(m.mutex);
+    if (int ret = enter(m, "close"); ret != AFP_SERVER_RESULT_OKAY)
+        return ret;
+    return m.openFiles.erase(fileid) ? AFP_SERVER_RESULT_OKAY : AFP_SERVER_RESULT_ENOENT;
+}
+
+} // extern "C"